@@ -7,3 +7,160 @@
 //
 
 #include "OSQLite.h"
+
+namespace OSQLite {
+namespace Performance {
+    
+    // Functions for OSDatabase
+    OSDatabase::OSDatabase() noexcept
+    {}
+    
+    OSDatabase::~OSDatabase()
+    {
+        this->close();
+    }
+    
+    OSStatus OSDatabase::open(const char* filePath_, int openFlags_) noexcept
+    {
+        if (_connection != nullptr) {
+            OSStatus _status = this->close();
+            if (!_status.ok())
+                return _status;
+        }
+        if (filePath_ == nullptr || filePath_[0] == '\0')
+            return OSStatus(SQLITE_MISUSE);
+        int _result = sqlite3_open_v2(filePath_, &_connection, openFlags_, nullptr);
+        if (_result != SQLITE_OK) {
+            sqlite3_close(_connection);
+            _connection = nullptr;
+        }
+        return OSStatus(_result);
+    }
+    
+    OSStatus OSDatabase::close() noexcept
+    {
+        if (_connection == nullptr)
+            return OSStatus(SQLITE_OK);
+        this->evict(0);
+        int _result = sqlite3_close(_connection);
+        if (_result == SQLITE_OK)
+            _connection = nullptr;
+        return OSStatus(_result);
+    }
+    
+    OSStatus OSDatabase::execute(const char* sqlString_) noexcept
+    {
+        if (_connection == nullptr)
+            return OSStatus(SQLITE_MISUSE);
+        return OSStatus(sqlite3_exec(_connection, sqlString_, nullptr, nullptr, nullptr));
+    }
+    
+    OSStatus OSDatabase::begin(const char* mode_) noexcept
+    {
+        if (mode_ == nullptr)
+            return this->execute("begin");
+        char _sql[32] = "begin ";
+        strncat(_sql, mode_, sizeof(_sql) - strlen(_sql) - 1);
+        return this->execute(_sql);
+    }
+    
+    OSStatus OSDatabase::commit() noexcept
+    {return this->execute("commit");}
+    
+    OSStatus OSDatabase::rollback() noexcept
+    {return this->execute("rollback");}
+    
+    void OSDatabase::setCacheCapacity(size_t capacity_) noexcept
+    {
+        _cacheCapacity = capacity_;
+        this->evict(capacity_);
+    }
+    
+    int OSDatabase::acquire(const char* sqlString_, size_t length_, sqlite3_stmt** statement_) noexcept
+    {
+        // A few entries: a linear scan is cheaper than hashing the SQL.
+        for (size_t _i = 0; _i < _cache.size(); ++_i) {
+            const char* _sql = sqlite3_sql(_cache[_i]);
+            if (strncmp(_sql, sqlString_, length_) == 0 && _sql[length_] == '\0') {
+                *statement_ = _cache[_i];
+                _cache.erase(_cache.begin() + _i);
+                return SQLITE_OK;
+            }
+        }
+        *statement_ = nullptr;
+        if (_connection == nullptr)
+            return SQLITE_MISUSE;
+        return sqlite3_prepare_v2(_connection, sqlString_, (int)length_ + 1, statement_, nullptr);
+    }
+    
+    void OSDatabase::release(sqlite3_stmt* statement_) noexcept
+    {
+        if (statement_ == nullptr)
+            return;
+        // The result of reset repeats the last step error, which has been
+        // returned already.
+        sqlite3_reset(statement_);
+        sqlite3_clear_bindings(statement_);
+        const char* _sql = sqlite3_sql(statement_);
+        for (size_t _i = 0; _i < _cache.size(); ++_i) {
+            // The same SQL is cached already, by another OSStatement.
+            if (strcmp(sqlite3_sql(_cache[_i]), _sql) == 0) {
+                sqlite3_finalize(statement_);
+                return;
+            }
+        }
+        if (_cacheCapacity == 0) {
+            sqlite3_finalize(statement_);
+            return;
+        }
+        // Reserved once, so that caching does not allocate afterwards.
+        if (_cache.capacity() < _cacheCapacity + 1)
+            _cache.reserve(_cacheCapacity + 1);
+        _cache.insert(_cache.begin(), statement_);
+        this->evict(_cacheCapacity);
+    }
+    
+    void OSDatabase::evict(size_t size_) noexcept
+    {
+        while (_cache.size() > size_) {
+            sqlite3_finalize(_cache.back());
+            _cache.pop_back();
+        }
+    }
+    
+    
+    
+    
+    // Functions for OSStatement
+    OSStatement::OSStatement(OSDatabase& database_) noexcept : _database(database_)
+    {}
+    
+    OSStatement::~OSStatement()
+    {
+        this->release();
+    }
+    
+    OSStatus OSStatement::prepare(const char* sqlString_) noexcept
+    {
+        if (sqlString_ == nullptr)
+            return OSStatus(SQLITE_MISUSE);
+        if (_statement != nullptr) {
+            // The same SQL again: no trip through the cache.
+            if (strcmp(sqlite3_sql(_statement), sqlString_) == 0) {
+                sqlite3_reset(_statement);
+                sqlite3_clear_bindings(_statement);
+                return OSStatus(SQLITE_OK);
+            }
+            this->release();
+        }
+        return OSStatus(_database.acquire(sqlString_, strlen(sqlString_), &_statement));
+    }
+    
+    void OSStatement::release() noexcept
+    {
+        _database.release(_statement);
+        _statement = nullptr;
+    }
+
+}
+}
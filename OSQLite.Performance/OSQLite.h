@@ -8,12 +8,11 @@
 //  Created by Steven Chang on 15/8/5.
 //  Copyright (c) 2015 Steven Chang. All rights reserved.
 //
-//  Interface-design stage. NOT accomplished.
 
 #pragma once
 
 /*
- rules... 
+ rules...
  no try/catch, no exceptions. -> Make use of SQLite result codes. - Or allow modification?
  limit use of templates.(->fast compiling)
  modified new/delete macros/overloading functions...
@@ -21,4 +20,458 @@
  blob type realizations
  DB open/close: RAII? Maybe not necessary.
  use of boost library?En...
- */
\ No newline at end of file
+ */
+
+/*
+ So far:
+ Nothing throws. Every function returns an OSStatus or an OSResult<T>
+ carrying the SQLite result code, and the library builds with
+ -fno-exceptions. Only the bind/column overloads and the variadic
+ execute functions are templates, the rest lives in OSQLite.cpp.
+ Strings are passed as const char*, and text columns are read in place.
+ A database is opened with open(), and closed by close() or the destructor.
+ */
+
+// C++ Standard Library
+#include <string>
+#include <vector>
+#include <utility>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef _MSC_VER
+// XCODE
+#include "sqlite3.h"// SQLite
+//  noexcept
+#	if !(__has_feature(cxx_noexcept))
+#		define noexcept throw()
+#	endif
+#else
+// VS
+#include "..\SQLite\sqlite3.h"// SQLite
+#	if _MSC_VER <= 1800
+//		noexcept
+#		define noexcept throw()
+#	endif
+#endif
+
+// Prepared statements kept per OSDatabase, see OSDatabase::setCacheCapacity.
+#ifndef OSQLITE_PERFORMANCE_CACHE_CAPACITY
+#define OSQLITE_PERFORMANCE_CACHE_CAPACITY 16
+#endif
+
+namespace OSQLite {
+namespace Performance {
+    
+    // Forward declaration
+    class OSStatus;
+    template <typename T>
+    class OSResult;
+    class OSDatabase;
+    class OSStatement;
+    
+    /*
+     *  OSStatus, the SQLite result code of an operation, e.g. SQLITE_OK,
+     *  SQLITE_CONSTRAINT or SQLITE_BUSY. It replaces OSException: nothing in
+     *  OSQLite::Performance throws, every failure is returned.
+     *  Use OSDatabase::errorMessage() for the message of the connection.
+     */
+    class OSStatus {
+        int _code;
+        
+    public:
+        explicit OSStatus(int code = SQLITE_OK) noexcept;
+        
+        // The SQLite result code.
+        inline int code() const noexcept;
+        // No error: SQLITE_OK, or SQLITE_ROW / SQLITE_DONE of a step.
+        inline bool ok() const noexcept;
+        // A step produced a row.
+        inline bool row() const noexcept;
+        inline explicit operator bool() const noexcept;
+        // English text of the code, by sqlite3_errstr.
+        inline const char* message() const noexcept;
+    };
+    
+    /*
+     *  OSResult<T>, a value or the result code saying why there is none.
+     *  code() is SQLITE_OK with a value, SQLITE_DONE if a query gave no row,
+     *  otherwise the error.
+     */
+    template <typename T>
+    class OSResult {
+        T _value;
+        int _code;
+        
+    public:
+        OSResult(const T& value);
+        OSResult(T&& value);
+        OSResult(OSStatus status);
+        
+        inline int code() const noexcept;
+        inline OSStatus status() const noexcept;
+        inline bool ok() const noexcept;
+        inline explicit operator bool() const noexcept;
+        
+        // The value, default constructed if !ok().
+        inline const T& value() const noexcept;
+        inline T& value() noexcept;
+        inline T valueOr(const T& defaultValue) const;
+    };
+    
+    /*
+     *  OSDatabase, one SQLite connection and its prepared statements.
+     *  Statements are checked out of the cache by OSStatement::prepare and
+     *  come back when the OSStatement prepares another SQL or is destroyed,
+     *  so every OSStatement must be destroyed before its OSDatabase.
+     */
+    class OSDatabase {
+        friend class OSStatement;
+        
+        sqlite3* _connection = nullptr;
+        
+        // Idle prepared statements, most recently used first. The key is
+        // sqlite3_sql of the statement.
+        std::vector<sqlite3_stmt*> _cache;
+        size_t _cacheCapacity = OSQLITE_PERFORMANCE_CACHE_CAPACITY;
+        
+        int acquire(const char* sqlString, size_t length, sqlite3_stmt** statement) noexcept;
+        void release(sqlite3_stmt* statement) noexcept;
+        void evict(size_t size) noexcept;
+        
+    public:
+        OSDatabase() noexcept;
+        OSDatabase(const OSDatabase&) = delete;
+        OSDatabase operator=(const OSDatabase&) = delete;
+        // Closes the connection if still open, ignoring the result.
+        ~OSDatabase();
+        
+        // Open a database file, flags of sqlite3_open_v2. An open connection
+        // is closed first.
+        OSStatus open(const char* filePath, int openFlags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE) noexcept;
+        // Finalize the cached statements and close. SQLITE_BUSY if an
+        // OSStatement of this database is still alive; it stays open then.
+        OSStatus close() noexcept;
+        inline bool isOpen() const noexcept;
+        inline sqlite3* connection() const noexcept;
+        
+        // The message and extended code of the last failure.
+        inline const char* errorMessage() const noexcept;
+        inline int extendedErrorCode() const noexcept;
+        
+        // Execute SQL without bindings nor results (sqlite3_exec), e.g.
+        // pragmas, several statements separated by ';'.
+        OSStatus execute(const char* sqlString) noexcept;
+        
+        // Transaction, mode is "deferred", "immediate" or "exclusive".
+        OSStatus begin(const char* mode = nullptr) noexcept;
+        OSStatus commit() noexcept;
+        OSStatus rollback() noexcept;
+        
+        // Cached statements, 0 prepares each SQL every time.
+        void setCacheCapacity(size_t capacity) noexcept;
+        inline size_t cacheCapacity() const noexcept;
+        inline size_t cacheSize() const noexcept;
+    };
+    
+    /*
+     *  OSStatement, one prepared statement at a time of an OSDatabase.
+     *  prepare() takes the statement from the cache of the database, bind()
+     *  and column() are sqlite3_bind_* and sqlite3_column_*, and step() runs it.
+     *  Preparing the same SQL again only resets it. Indexes follow SQLite:
+     *  bind from 1, column from 0. Text and blobs are bound with
+     *  SQLITE_TRANSIENT. e.g.
+     *      OSStatement statement(database);
+     *      if (!statement.execute("insert into Person(id, name) values(?, ?)", 1, "Steven"))
+     *          printf("%s\n", database.errorMessage());
+     *      OSResult<int> count = statement.executeScalar<int>("select count(*) from Person");
+     */
+    class OSStatement {
+        OSDatabase& _database;
+        sqlite3_stmt* _statement = nullptr;
+        
+    public:
+        explicit OSStatement(OSDatabase& database) noexcept;
+        OSStatement(const OSStatement&) = delete;
+        OSStatement operator=(const OSStatement&) = delete;
+        ~OSStatement();
+        
+        // Prepare (or take from the cache) the statement of sqlString.
+        // Bindings are cleared.
+        OSStatus prepare(const char* sqlString) noexcept;
+        // Give the statement back to the cache of the database.
+        void release() noexcept;
+        inline sqlite3_stmt* statement() const noexcept;
+        
+        // Bind one parameter, index from 1. nullptr binds NULL.
+        inline OSStatus bind(int index, int value) noexcept;
+        inline OSStatus bind(int index, long long value) noexcept;
+        inline OSStatus bind(int index, double value) noexcept;
+        inline OSStatus bind(int index, const char* value) noexcept;
+        inline OSStatus bind(int index, const char* value, size_t size) noexcept;
+        inline OSStatus bind(int index, const std::string& value) noexcept;
+        inline OSStatus bind(int index, std::nullptr_t) noexcept;
+        inline OSStatus bindBlob(int index, const void* data, size_t size) noexcept;
+        // Bind args to the parameters 1, 2, ... in order. Stops at the first
+        // failure.
+        template <typename... Args>
+        inline OSStatus bindAll(const Args&... args) noexcept;
+        
+        // SQLITE_ROW or SQLITE_DONE, or the error.
+        inline OSStatus step() noexcept;
+        // Reset to run again; bindings are kept.
+        inline OSStatus reset() noexcept;
+        
+        // Columns of the current row, index from 0.
+        inline int columnCount() const noexcept;
+        inline bool isNull(int index) const noexcept;
+        inline int columnInt(int index) const noexcept;
+        inline long long columnInt64(int index) const noexcept;
+        inline double columnDouble(int index) const noexcept;
+        // Valid until the next step; size, if given, gets the length in bytes.
+        inline const char* columnText(int index, size_t* size = nullptr) const noexcept;
+        inline const void* columnBlob(int index, size_t* size = nullptr) const noexcept;
+        // Read the column into value, for the templates below.
+        inline void column(int index, int& value) const noexcept;
+        inline void column(int index, long long& value) const noexcept;
+        inline void column(int index, double& value) const noexcept;
+        inline void column(int index, std::string& value) const;
+        
+        // prepare, bindAll, step until done. SQLITE_OK on success.
+        template <typename... Args>
+        inline OSStatus execute(const char* sqlString, const Args&... args) noexcept;
+        // The first column of the first row, code SQLITE_DONE if no row.
+        template <typename T, typename... Args>
+        inline OSResult<T> executeScalar(const char* sqlString, const Args&... args);
+    };
+    
+    
+    
+    
+    // Functions for OSStatus
+    inline OSStatus::OSStatus(int code_) noexcept : _code(code_)
+    {}
+    
+    inline int OSStatus::code() const noexcept
+    {return _code;}
+    
+    inline bool OSStatus::ok() const noexcept
+    {return _code == SQLITE_OK || _code == SQLITE_ROW || _code == SQLITE_DONE;}
+    
+    inline bool OSStatus::row() const noexcept
+    {return _code == SQLITE_ROW;}
+    
+    inline OSStatus::operator bool() const noexcept
+    {return this->ok();}
+    
+    inline const char* OSStatus::message() const noexcept
+    {return sqlite3_errstr(_code);}
+    
+    
+    
+    
+    // Functions for OSResult
+    template <typename T>
+    OSResult<T>::OSResult(const T& value_) : _value(value_), _code(SQLITE_OK)
+    {}
+    
+    template <typename T>
+    OSResult<T>::OSResult(T&& value_) : _value(std::move(value_)), _code(SQLITE_OK)
+    {}
+    
+    template <typename T>
+    OSResult<T>::OSResult(OSStatus status_) : _value(), _code(status_.code())
+    {}
+    
+    template <typename T>
+    inline int OSResult<T>::code() const noexcept
+    {return _code;}
+    
+    template <typename T>
+    inline OSStatus OSResult<T>::status() const noexcept
+    {return OSStatus(_code);}
+    
+    template <typename T>
+    inline bool OSResult<T>::ok() const noexcept
+    {return _code == SQLITE_OK;}
+    
+    template <typename T>
+    inline OSResult<T>::operator bool() const noexcept
+    {return _code == SQLITE_OK;}
+    
+    template <typename T>
+    inline const T& OSResult<T>::value() const noexcept
+    {return _value;}
+    
+    template <typename T>
+    inline T& OSResult<T>::value() noexcept
+    {return _value;}
+    
+    template <typename T>
+    inline T OSResult<T>::valueOr(const T& defaultValue_) const
+    {return _code == SQLITE_OK ? _value : defaultValue_;}
+    
+    
+    
+    
+    // Functions for OSDatabase
+    inline bool OSDatabase::isOpen() const noexcept
+    {return _connection != nullptr;}
+    
+    inline sqlite3* OSDatabase::connection() const noexcept
+    {return _connection;}
+    
+    inline const char* OSDatabase::errorMessage() const noexcept
+    {return _connection != nullptr ? sqlite3_errmsg(_connection) : "Database is not open";}
+    
+    inline int OSDatabase::extendedErrorCode() const noexcept
+    {return _connection != nullptr ? sqlite3_extended_errcode(_connection) : SQLITE_MISUSE;}
+    
+    inline size_t OSDatabase::cacheCapacity() const noexcept
+    {return _cacheCapacity;}
+    
+    inline size_t OSDatabase::cacheSize() const noexcept
+    {return _cache.size();}
+    
+    
+    
+    
+    // Functions for OSStatement
+    inline sqlite3_stmt* OSStatement::statement() const noexcept
+    {return _statement;}
+    
+    inline OSStatus OSStatement::bind(int index_, int value_) noexcept
+    {return OSStatus(sqlite3_bind_int(_statement, index_, value_));}
+    
+    inline OSStatus OSStatement::bind(int index_, long long value_) noexcept
+    {return OSStatus(sqlite3_bind_int64(_statement, index_, value_));}
+    
+    inline OSStatus OSStatement::bind(int index_, double value_) noexcept
+    {return OSStatus(sqlite3_bind_double(_statement, index_, value_));}
+    
+    inline OSStatus OSStatement::bind(int index_, const char* value_) noexcept
+    {
+        if (value_ == nullptr)
+            return OSStatus(sqlite3_bind_null(_statement, index_));
+        return OSStatus(sqlite3_bind_text(_statement, index_, value_, -1, SQLITE_TRANSIENT));
+    }
+    
+    inline OSStatus OSStatement::bind(int index_, const char* value_, size_t size_) noexcept
+    {return OSStatus(sqlite3_bind_text(_statement, index_, value_, (int)size_, SQLITE_TRANSIENT));}
+    
+    inline OSStatus OSStatement::bind(int index_, const std::string& value_) noexcept
+    {return OSStatus(sqlite3_bind_text(_statement, index_, value_.data(), (int)value_.size(), SQLITE_TRANSIENT));}
+    
+    inline OSStatus OSStatement::bind(int index_, std::nullptr_t) noexcept
+    {return OSStatus(sqlite3_bind_null(_statement, index_));}
+    
+    inline OSStatus OSStatement::bindBlob(int index_, const void* data_, size_t size_) noexcept
+    {return OSStatus(sqlite3_bind_blob(_statement, index_, data_, (int)size_, SQLITE_TRANSIENT));}
+    
+    template <typename... Args>
+    inline OSStatus OSStatement::bindAll(const Args&... args_) noexcept
+    {
+        int _index = 0;
+        int _result = SQLITE_OK;
+        // Braced lists are evaluated in order.
+        int _expansion[] = {0, (_result == SQLITE_OK ? (_result = this->bind(++_index, args_).code()) : 0)...};
+        (void)_expansion;
+        return OSStatus(_result);
+    }
+    
+    inline OSStatus OSStatement::step() noexcept
+    {
+        if (_statement == nullptr)
+            return OSStatus(SQLITE_MISUSE);
+        return OSStatus(sqlite3_step(_statement));
+    }
+    
+    inline OSStatus OSStatement::reset() noexcept
+    {return OSStatus(sqlite3_reset(_statement));}
+    
+    inline int OSStatement::columnCount() const noexcept
+    {return sqlite3_column_count(_statement);}
+    
+    inline bool OSStatement::isNull(int index_) const noexcept
+    {return sqlite3_column_type(_statement, index_) == SQLITE_NULL;}
+    
+    inline int OSStatement::columnInt(int index_) const noexcept
+    {return sqlite3_column_int(_statement, index_);}
+    
+    inline long long OSStatement::columnInt64(int index_) const noexcept
+    {return sqlite3_column_int64(_statement, index_);}
+    
+    inline double OSStatement::columnDouble(int index_) const noexcept
+    {return sqlite3_column_double(_statement, index_);}
+    
+    inline const char* OSStatement::columnText(int index_, size_t* size_) const noexcept
+    {
+        // Text before bytes, as SQLite recommends.
+        const char* _text = (const char*)sqlite3_column_text(_statement, index_);
+        if (size_ != nullptr)
+            *size_ = (size_t)sqlite3_column_bytes(_statement, index_);
+        return _text;
+    }
+    
+    inline const void* OSStatement::columnBlob(int index_, size_t* size_) const noexcept
+    {
+        const void* _blob = sqlite3_column_blob(_statement, index_);
+        if (size_ != nullptr)
+            *size_ = (size_t)sqlite3_column_bytes(_statement, index_);
+        return _blob;
+    }
+    
+    inline void OSStatement::column(int index_, int& value_) const noexcept
+    {value_ = sqlite3_column_int(_statement, index_);}
+    
+    inline void OSStatement::column(int index_, long long& value_) const noexcept
+    {value_ = sqlite3_column_int64(_statement, index_);}
+    
+    inline void OSStatement::column(int index_, double& value_) const noexcept
+    {value_ = sqlite3_column_double(_statement, index_);}
+    
+    inline void OSStatement::column(int index_, std::string& value_) const
+    {
+        size_t _size = 0;
+        const char* _text = this->columnText(index_, &_size);
+        if (_text != nullptr)
+            value_.assign(_text, _size);
+        else
+            value_.clear();
+    }
+    
+    template <typename... Args>
+    inline OSStatus OSStatement::execute(const char* sqlString_, const Args&... args_) noexcept
+    {
+        OSStatus _status = this->prepare(sqlString_);
+        if (_status.ok())
+            _status = this->bindAll(args_...);
+        if (!_status.ok())
+            return _status;
+        while ((_status = this->step()).row());
+        // Reset at once, so that the statement holds no lock.
+        sqlite3_reset(_statement);
+        return _status.ok() ? OSStatus(SQLITE_OK) : _status;
+    }
+    
+    template <typename T, typename... Args>
+    inline OSResult<T> OSStatement::executeScalar(const char* sqlString_, const Args&... args_)
+    {
+        OSStatus _status = this->prepare(sqlString_);
+        if (_status.ok())
+            _status = this->bindAll(args_...);
+        if (!_status.ok())
+            return OSResult<T>(_status);
+        _status = this->step();
+        if (!_status.row()) {
+            sqlite3_reset(_statement);
+            return OSResult<T>(_status.ok() ? OSStatus(SQLITE_DONE) : _status);
+        }
+        T _value;
+        this->column(0, _value);
+        sqlite3_reset(_statement);
+        return OSResult<T>(std::move(_value));
+    }
+
+}
+}
@@ -5,12 +5,553 @@
 //  Created by Steven Chang on 15/8/5.
 //  Copyright (c) 2015 Steven Chang. All rights reserved.
 //
+//  Benchmark of the OSQLite wrapper against raw sqlite3 calls.
+//  Usage: OSQLite.Performance [result.csv] [database file]
+//  Every scenario runs on a fresh table, raw sqlite3 first, with the same
+//  data and the same SQL. Raw sqlite3 reuses one prepared statement, which is
+//  the best case the wrapper's statement cache can reach.
+//  Implementations: raw (sqlite3), OSQLite (OSQLite.Safety, exceptions) and
+//  Perf (OSQLite::Performance, result codes). allocs counts the C++ heap
+//  and the SQLite heap together.
+//
 
+#include "../OSQLite.Safety/OSQLite.h"
+#include "OSQLite.h"
 #include <iostream>
+#include <fstream>
+#include <atomic>
+#include <new>
+#include <stdio.h>
 #include <boost/format.hpp>
 
-int main(int argc, const char * argv[]) {
-    // insert code here...
-    std::cout << "Hello, World!\n";
+namespace Perf = OSQLite::Performance;
+
+// Allocations counter. Every operator new of the process goes through it,
+// and so does every sqlite3 allocation once countSQLiteAllocations is done.
+static std::atomic<unsigned long long> allocationCount(0);
+
+// Not inlined: GCC would then see free() on the result of new, and warn.
+#if defined(__GNUC__)
+#define OSQLITE_BENCH_NOINLINE __attribute__((noinline))
+#else
+#define OSQLITE_BENCH_NOINLINE
+#endif
+
+OSQLITE_BENCH_NOINLINE void* operator new(std::size_t size)
+{
+    ++allocationCount;
+    void* _pointer = malloc(size > 0 ? size : 1);
+    if (_pointer == nullptr)
+        throw std::bad_alloc();
+    return _pointer;
+}
+
+OSQLITE_BENCH_NOINLINE void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+OSQLITE_BENCH_NOINLINE void operator delete(void* pointer) noexcept
+{
+    free(pointer);
+}
+
+OSQLITE_BENCH_NOINLINE void operator delete[](void* pointer) noexcept
+{
+    free(pointer);
+}
+
+#if defined(__cpp_sized_deallocation)
+OSQLITE_BENCH_NOINLINE void operator delete(void* pointer, std::size_t) noexcept
+{
+    free(pointer);
+}
+
+OSQLITE_BENCH_NOINLINE void operator delete[](void* pointer, std::size_t) noexcept
+{
+    free(pointer);
+}
+#endif
+
+// The allocator SQLite had, wrapped by the counting one.
+static sqlite3_mem_methods sqliteAllocator;
+
+static void* countingMalloc(int size)
+{
+    ++allocationCount;
+    return sqliteAllocator.xMalloc(size);
+}
+
+static void* countingRealloc(void* pointer, int size)
+{
+    ++allocationCount;
+    return sqliteAllocator.xRealloc(pointer, size);
+}
+
+// Must run before SQLite is initialized, i.e. before the first connection.
+void countSQLiteAllocations()
+{
+    sqlite3_config(SQLITE_CONFIG_GETMALLOC, &sqliteAllocator);
+    sqlite3_mem_methods _counting = sqliteAllocator;
+    _counting.xMalloc = countingMalloc;
+    _counting.xRealloc = countingRealloc;
+    int _result = sqlite3_config(SQLITE_CONFIG_MALLOC, &_counting);
+    if (_result != SQLITE_OK)
+        throw OSQLite::OSException("Cannot count the SQLite allocations", _result);
+}
+
+// One line of the report.
+struct BenchmarkResult {
+    std::string scenario;
+    std::string implementation;
+    size_t rows;
+    size_t transactionSize;
+    size_t ops;
+    double opsPerSecond;
+    double p50;// ns
+    double p99;// ns
+    double allocationsPerOp;
+};
+
+std::vector<BenchmarkResult> results;
+std::string databaseFilePath = "osqlite_benchmark.db";
+
+// Times each call of operation(i), i in [0, ops).
+template <typename Operation>
+void measure(const std::string& scenario, const std::string& implementation, size_t rows, size_t transactionSize, size_t ops, Operation operation)
+{
+    std::vector<double> _latencies(ops);
+    unsigned long long _allocations = allocationCount.load();
+    auto _start = std::chrono::steady_clock::now();
+    for (size_t _i = 0; _i < ops; ++_i) {
+        auto _opStart = std::chrono::steady_clock::now();
+        operation(_i);
+        _latencies[_i] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _opStart).count();
+    }
+    double _seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    _allocations = allocationCount.load() - _allocations;
+
+    std::sort(_latencies.begin(), _latencies.end());
+    BenchmarkResult _result;
+    _result.scenario = scenario;
+    _result.implementation = implementation;
+    _result.rows = rows;
+    _result.transactionSize = transactionSize;
+    _result.ops = ops;
+    _result.opsPerSecond = ops / _seconds;
+    _result.p50 = _latencies[ops / 2];
+    _result.p99 = _latencies[std::min(ops - 1, ops * 99 / 100)];
+    _result.allocationsPerOp = double(_allocations) / ops;
+    results.push_back(_result);
+
+    std::cout << boost::format("%-14s %-8s %7d %5d %8d %12.0f %10.0f %10.0f %8.2f") % scenario % implementation % rows % transactionSize % ops % _result.opsPerSecond % _result.p50 % _result.p99 % _result.allocationsPerOp << std::endl;
+}
+
+// Helpers of the raw sqlite3 side.
+sqlite3_stmt* rawPrepare(sqlite3* connection, const char* sqlString)
+{
+    sqlite3_stmt* _statement = nullptr;
+    if (sqlite3_prepare_v2(connection, sqlString, -1, &_statement, nullptr) != SQLITE_OK)
+        throw OSQLite::OSException(sqlite3_errmsg(connection));
+    return _statement;
+}
+
+void rawStep(sqlite3_stmt* statement)
+{
+    int _result = sqlite3_step(statement);
+    sqlite3_reset(statement);
+    if (_result != SQLITE_DONE && _result != SQLITE_ROW)
+        throw OSQLite::OSException("raw sqlite3_step failed", _result);
+}
+
+// Result codes of the Performance side; a failure ends the benchmark.
+void perfCheck(Perf::OSStatus status, const Perf::OSDatabase& database)
+{
+    if (!status.ok())
+        throw OSQLite::OSException(database.errorMessage(), status.code());
+}
+
+// Fresh table with rows rows, through its own connection.
+void resetTable(size_t rows)
+{
+    OSQLite::OSDatabase _database(databaseFilePath);
+    OSQLite::OSStatement _statement(_database);
+    _statement.execute("drop table if exists Bench");
+    _statement.execute("create table Bench(id integer not null, name text, score real, primary key(id))");
+    _statement.begin();
+    for (int _id = 1; _id <= int(rows); ++_id) {
+        std::string _name = "name_" + std::to_string(_id);
+        double _score = _id * 0.5;
+        _statement.execute("insert into Bench(id, name, score) values(?, ?, ?)", _id, _name, _score);
+    }
+    _statement.commit();
+}
+
+std::vector<std::string> makeNames(size_t count)
+{
+    std::vector<std::string> _names;
+    for (size_t _i = 0; _i < count; ++_i)
+        _names.push_back("name_" + std::to_string(_i + 1));
+    return _names;
+}
+
+// Benchmark: single row inserts, transactionSize inserts per transaction
+// (1: autocommit).
+void benchmark_insert(size_t ops, size_t transactionSize)
+{
+    std::vector<std::string> _names = makeNames(ops);
+    const char* _sql = "insert into Bench(id, name, score) values(?, ?, ?)";
+    auto _begins = [transactionSize](size_t i) {return transactionSize > 1 && i % transactionSize == 0;};
+    auto _commits = [transactionSize, ops](size_t i) {return transactionSize > 1 && (i % transactionSize == transactionSize - 1 || i == ops - 1);};
+
+    resetTable(0);
+    {
+        sqlite3* _connection = nullptr;
+        sqlite3_open(databaseFilePath.c_str(), &_connection);
+        sqlite3_stmt* _statement = rawPrepare(_connection, _sql);
+        measure("insert", "raw", 0, transactionSize, ops, [&](size_t i) {
+            if (_begins(i))
+                sqlite3_exec(_connection, "begin", nullptr, nullptr, nullptr);
+            sqlite3_bind_int(_statement, 1, int(i + 1));
+            sqlite3_bind_text(_statement, 2, _names[i].c_str(), int(_names[i].size()), SQLITE_TRANSIENT);
+            sqlite3_bind_double(_statement, 3, i * 0.5);
+            rawStep(_statement);
+            if (_commits(i))
+                sqlite3_exec(_connection, "commit", nullptr, nullptr, nullptr);
+        });
+        sqlite3_finalize(_statement);
+        sqlite3_close(_connection);
+    }
+
+    resetTable(0);
+    {
+        OSQLite::OSDatabase _database(databaseFilePath);
+        OSQLite::OSStatement _statement(_database);
+        measure("insert", "OSQLite", 0, transactionSize, ops, [&](size_t i) {
+            if (_begins(i))
+                _statement.begin();
+            int _id = int(i + 1);
+            double _score = i * 0.5;
+            _statement.execute(_sql, _id, _names[i], _score);
+            if (_commits(i))
+                _statement.commit();
+        });
+    }
+
+    resetTable(0);
+    {
+        Perf::OSDatabase _database;
+        perfCheck(_database.open(databaseFilePath.c_str()), _database);
+        Perf::OSStatement _statement(_database);
+        measure("insert", "Perf", 0, transactionSize, ops, [&](size_t i) {
+            if (_begins(i))
+                perfCheck(_database.begin(), _database);
+            perfCheck(_statement.execute(_sql, int(i + 1), _names[i], i * 0.5), _database);
+            if (_commits(i))
+                perfCheck(_database.commit(), _database);
+        });
+    }
+}
+
+// Benchmark: point lookups of one column, by column type.
+void benchmark_scalar(size_t rows, size_t ops)
+{
+    resetTable(rows);
+    const char* _sqls[3] = {"select id from Bench where id=?", "select score from Bench where id=?", "select name from Bench where id=?"};
+    const char* _scenarios[3] = {"scalar-int", "scalar-real", "scalar-text"};
+    for (int _type = 0; _type < 3; ++_type) {
+        {
+            sqlite3* _connection = nullptr;
+            sqlite3_open(databaseFilePath.c_str(), &_connection);
+            sqlite3_stmt* _statement = rawPrepare(_connection, _sqls[_type]);
+            long long _checksum = 0;
+            measure(_scenarios[_type], "raw", rows, 1, ops, [&](size_t i) {
+                sqlite3_bind_int(_statement, 1, int(i % rows + 1));
+                if (sqlite3_step(_statement) == SQLITE_ROW) {
+                    if (_type == 0)
+                        _checksum += sqlite3_column_int(_statement, 0);
+                    else if (_type == 1)
+                        _checksum += (long long)sqlite3_column_double(_statement, 0);
+                    else
+                        _checksum += std::string((const char*)sqlite3_column_text(_statement, 0), sqlite3_column_bytes(_statement, 0)).size();
+                }
+                sqlite3_reset(_statement);
+            });
+            sqlite3_finalize(_statement);
+            sqlite3_close(_connection);
+        }
+        {
+            OSQLite::OSDatabase _database(databaseFilePath);
+            OSQLite::OSStatement _statement(_database);
+            long long _checksum = 0;
+            measure(_scenarios[_type], "OSQLite", rows, 1, ops, [&](size_t i) {
+                int _id = int(i % rows + 1);
+                if (_type == 0)
+                    _checksum += _statement.executeScalar<int>(_sqls[_type], _id);
+                else if (_type == 1)
+                    _checksum += (long long)_statement.executeScalar<double>(_sqls[_type], _id);
+                else
+                    _checksum += _statement.executeScalar<std::string>(_sqls[_type], _id).size();
+            });
+        }
+        {
+            Perf::OSDatabase _database;
+            perfCheck(_database.open(databaseFilePath.c_str()), _database);
+            Perf::OSStatement _statement(_database);
+            long long _checksum = 0;
+            measure(_scenarios[_type], "Perf", rows, 1, ops, [&](size_t i) {
+                int _id = int(i % rows + 1);
+                if (_type == 0)
+                    _checksum += _statement.executeScalar<int>(_sqls[_type], _id).value();
+                else if (_type == 1)
+                    _checksum += (long long)_statement.executeScalar<double>(_sqls[_type], _id).value();
+                else
+                    _checksum += _statement.executeScalar<std::string>(_sqls[_type], _id).value().size();
+            });
+        }
+    }
+}
+
+// Benchmark: reading rows rows of (int, text, real) into a container.
+void benchmark_rows(size_t rows, size_t ops)
+{
+    resetTable(rows);
+    const char* _sql = "select id, name, score from Bench where id<=?";
+    int _limit = int(rows);
+    {
+        sqlite3* _connection = nullptr;
+        sqlite3_open(databaseFilePath.c_str(), &_connection);
+        sqlite3_stmt* _statement = rawPrepare(_connection, _sql);
+        size_t _count = 0;
+        measure("rows", "raw", rows, 1, ops, [&](size_t i) {
+            std::vector<std::tuple<int, std::string, double>> _rows;
+            sqlite3_bind_int(_statement, 1, _limit);
+            while (sqlite3_step(_statement) == SQLITE_ROW) {
+                _rows.emplace_back(sqlite3_column_int(_statement, 0),
+                                   std::string((const char*)sqlite3_column_text(_statement, 1), sqlite3_column_bytes(_statement, 1)),
+                                   sqlite3_column_double(_statement, 2));
+            }
+            sqlite3_reset(_statement);
+            _count += _rows.size();
+        });
+        sqlite3_finalize(_statement);
+        sqlite3_close(_connection);
+    }
+    {
+        OSQLite::OSDatabase _database(databaseFilePath);
+        OSQLite::OSStatement _statement(_database);
+        size_t _count = 0;
+        measure("rows", "OSQLite", rows, 1, ops, [&](size_t i) {
+            _count += _statement.executeRows<int, std::string, double>(_sql, _limit).size();
+        });
+    }
+    {
+        Perf::OSDatabase _database;
+        perfCheck(_database.open(databaseFilePath.c_str()), _database);
+        Perf::OSStatement _statement(_database);
+        size_t _count = 0;
+        measure("rows", "Perf", rows, 1, ops, [&](size_t i) {
+            std::vector<std::tuple<int, std::string, double>> _rows;
+            perfCheck(_statement.prepare(_sql), _database);
+            perfCheck(_statement.bind(1, _limit), _database);
+            Perf::OSStatus _status;
+            while ((_status = _statement.step()).row()) {
+                size_t _size = 0;
+                const char* _name = _statement.columnText(1, &_size);
+                _rows.emplace_back(_statement.columnInt(0), std::string(_name, _size), _statement.columnDouble(2));
+            }
+            perfCheck(_status, _database);
+            _count += _rows.size();
+        });
+    }
+}
+
+// Sample table class of the OSQuery benchmark.
+class Record : virtual public OSQLite::OSTablePolicy<Record> {
+public:
+    Record(int id, const std::string& name, double score):OSTablePolicy("Bench", {"id", "name", "score"}, _id, _name, _score), _id(id), _name(name), _score(score) {}
+    virtual ~Record() {}
+
+    int _id;
+    std::string _name;
+    double _score;
+};
+
+// Benchmark: OSQuery CRUD against the same statements by hand, all in one
+// transaction so that the journal does not hide the difference.
+void benchmark_query(size_t ops)
+{
+    std::vector<std::string> _names = makeNames(ops);
+    const char* _sqls[5] = {
+        "insert into Bench(id, name, score) values(?, ?, ?)",
+        "select count(*) from Bench where id=?",
+        "select name, score from Bench where id=?",
+        "update Bench set name=?, score=? where id=?",
+        "delete from Bench where id=?"};
+    const char* _scenarios[5] = {"query-save", "query-exists", "query-fill", "query-update", "query-delete"};
+
+    resetTable(0);
+    {
+        sqlite3* _connection = nullptr;
+        sqlite3_open(databaseFilePath.c_str(), &_connection);
+        sqlite3_exec(_connection, "begin", nullptr, nullptr, nullptr);
+        for (int _kind = 0; _kind < 5; ++_kind) {
+            sqlite3_stmt* _statement = rawPrepare(_connection, _sqls[_kind]);
+            std::string _name;
+            double _score = 0;
+            measure(_scenarios[_kind], "raw", ops, ops, ops, [&](size_t i) {
+                int _id = int(i + 1);
+                if (_kind == 0) {
+                    sqlite3_bind_int(_statement, 1, _id);
+                    sqlite3_bind_text(_statement, 2, _names[i].c_str(), int(_names[i].size()), SQLITE_TRANSIENT);
+                    sqlite3_bind_double(_statement, 3, i * 0.5);
+                    rawStep(_statement);
+                } else if (_kind == 1 || _kind == 4) {
+                    sqlite3_bind_int(_statement, 1, _id);
+                    rawStep(_statement);
+                } else if (_kind == 2) {
+                    sqlite3_bind_int(_statement, 1, _id);
+                    if (sqlite3_step(_statement) == SQLITE_ROW) {
+                        _name.assign((const char*)sqlite3_column_text(_statement, 0), sqlite3_column_bytes(_statement, 0));
+                        _score = sqlite3_column_double(_statement, 1);
+                    }
+                    sqlite3_reset(_statement);
+                } else {
+                    sqlite3_bind_text(_statement, 1, _names[i].c_str(), int(_names[i].size()), SQLITE_TRANSIENT);
+                    sqlite3_bind_double(_statement, 2, i * 1.5);
+                    sqlite3_bind_int(_statement, 3, _id);
+                    rawStep(_statement);
+                }
+            });
+            sqlite3_finalize(_statement);
+        }
+        sqlite3_exec(_connection, "commit", nullptr, nullptr, nullptr);
+        sqlite3_close(_connection);
+    }
+
+    resetTable(0);
+    {
+        OSQLite::OSDatabase _database(databaseFilePath);
+        OSQLite::OSStatement _statement(_database);
+        OSQLite::OSQuery _query(_database);
+        Record _record(0, "", 0);
+        _statement.begin();
+        for (int _kind = 0; _kind < 5; ++_kind) {
+            measure(_scenarios[_kind], "OSQLite", ops, ops, ops, [&](size_t i) {
+                _record._id = int(i + 1);
+                if (_kind == 0) {
+                    _record._name = _names[i];
+                    _record._score = i * 0.5;
+                    _query.save(_record);
+                } else if (_kind == 1) {
+                    _query.exists(_record);
+                } else if (_kind == 2) {
+                    _query.fill(_record);
+                } else if (_kind == 3) {
+                    _record._name = _names[i];
+                    _record._score = i * 1.5;
+                    _query.update(_record);
+                } else {
+                    _query.deleteObject(_record);
+                }
+            });
+        }
+        _statement.commit();
+    }
+
+    resetTable(0);
+    {
+        Perf::OSDatabase _database;
+        perfCheck(_database.open(databaseFilePath.c_str()), _database);
+        Perf::OSStatement _statement(_database);
+        std::string _name;
+        double _score = 0;
+        perfCheck(_database.begin(), _database);
+        for (int _kind = 0; _kind < 5; ++_kind) {
+            measure(_scenarios[_kind], "Perf", ops, ops, ops, [&](size_t i) {
+                int _id = int(i + 1);
+                if (_kind == 0) {
+                    perfCheck(_statement.execute(_sqls[_kind], _id, _names[i], i * 0.5), _database);
+                } else if (_kind == 1) {
+                    perfCheck(_statement.executeScalar<int>(_sqls[_kind], _id).status(), _database);
+                } else if (_kind == 2) {
+                    perfCheck(_statement.prepare(_sqls[_kind]), _database);
+                    perfCheck(_statement.bind(1, _id), _database);
+                    Perf::OSStatus _status = _statement.step();
+                    if (_status.row()) {
+                        _statement.column(0, _name);
+                        _score = _statement.columnDouble(1);
+                    }
+                    perfCheck(_status, _database);
+                } else if (_kind == 3) {
+                    perfCheck(_statement.execute(_sqls[_kind], _names[i], i * 1.5, _id), _database);
+                } else {
+                    perfCheck(_statement.execute(_sqls[_kind], _id), _database);
+                }
+            });
+        }
+        perfCheck(_database.commit(), _database);
+    }
+}
+
+// Result codes of the Performance API in the failure cases, checked before
+// timing anything.
+void checkPerformance()
+{
+    remove(databaseFilePath.c_str());
+    Perf::OSDatabase _database;
+    perfCheck(_database.open(databaseFilePath.c_str()), _database);
+    {
+        Perf::OSStatement _statement(_database);
+        perfCheck(_statement.execute("create table Bench(id integer not null, name text, score real, primary key(id))"), _database);
+        perfCheck(_statement.execute("insert into Bench(id, name, score) values(?, ?, ?)", 1, "name_1", 0.5), _database);
+        if (_statement.execute("insert into Bench(id, name, score) values(?, ?, ?)", 1, "name_1", 0.5).code() != SQLITE_CONSTRAINT)
+            throw OSQLite::OSException("Performance: duplicate key not reported");
+        if (_statement.execute("select nothing from Nowhere").code() != SQLITE_ERROR)
+            throw OSQLite::OSException("Performance: invalid SQL not reported");
+        Perf::OSResult<std::string> _name = _statement.executeScalar<std::string>("select name from Bench where id=?", 1);
+        if (!_name.ok() || _name.value() != "name_1")
+            throw OSQLite::OSException("Performance: executeScalar failed", _name.code());
+        if (_statement.executeScalar<int>("select id from Bench where id=?", 2).code() != SQLITE_DONE)
+            throw OSQLite::OSException("Performance: missing row not reported");
+        if (_database.close().code() != SQLITE_BUSY)
+            throw OSQLite::OSException("Performance: close with a live statement");
+    }
+    perfCheck(_database.close(), _database);
+    remove(databaseFilePath.c_str());
+}
+
+int main(int argc, const char * argv[])
+try {
+    std::string _csvPath = argc > 1 ? argv[1] : "osqlite_benchmark.csv";
+    if (argc > 2)
+        databaseFilePath = argv[2];
+    remove(databaseFilePath.c_str());
+    remove((databaseFilePath + "-journal").c_str());
+
+    countSQLiteAllocations();
+    checkPerformance();
+    std::cout << boost::format("%-14s %-8s %7s %5s %8s %12s %10s %10s %8s") % "scenario" % "impl" % "rows" % "tx" % "ops" % "ops/sec" % "p50(ns)" % "p99(ns)" % "allocs" << std::endl;
+    benchmark_insert(200, 1);
+    benchmark_insert(20000, 100);
+    benchmark_insert(20000, 1000);
+    benchmark_scalar(1000, 50000);
+    benchmark_rows(10, 20000);
+    benchmark_rows(100, 5000);
+    benchmark_rows(1000, 500);
+    benchmark_query(20000);
+
+    std::ofstream _csv(_csvPath);
+    _csv << "scenario,implementation,rows,transaction_size,ops,ops_per_sec,p50_ns,p99_ns,allocations_per_op\n";
+    for (auto& _result : results) {
+        _csv << _result.scenario << ',' << _result.implementation << ',' << _result.rows << ',' << _result.transactionSize << ',' << _result.ops << ','
+             << _result.opsPerSecond << ',' << _result.p50 << ',' << _result.p99 << ',' << _result.allocationsPerOp << '\n';
+    }
+    std::cout << "Results written to " << _csvPath << std::endl;
+
+    remove(databaseFilePath.c_str());
     return 0;
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    return 1;
 }
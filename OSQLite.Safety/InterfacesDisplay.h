@@ -16,10 +16,19 @@
 
 namespace OSQLite {
     class OSException;
+    struct OSTextView;
+    struct OSBlobView;
+    template <typename T>
+    class OSNullable;
     template <class _Derived_>
     class OSTablePolicy;
+    struct OSBatchTiming;
     class OSQuery;
+    template <typename... Returns>
+    class OSCursor;
     class OSStatement;
+    class OSStatementCache;
+    struct OSObjectCacheStatistics;
     class OSDatabase;
     
     /*
@@ -35,6 +44,103 @@ namespace OSQLite {
         virtual const unsigned tag() const noexcept;
     };
     
+    /*
+     *  OSTextView and OSBlobView, zero-copy result types of text and blob
+     *  columns, pointing into SQLite's buffer of the current row. Valid until
+     *  the next step; use them with OSStatement::executeCursor.
+     */
+    struct OSTextView {
+        const char* data;
+        size_t size;
+        
+        bool isNull() const noexcept;
+        std::string str() const;
+        bool operator==(const std::string& other) const noexcept;
+        bool operator!=(const std::string& other) const noexcept;
+    };
+    struct OSBlobView {
+        const unsigned char* data;
+        size_t size;
+        
+        OSBlobView();
+        OSBlobView(const void* data, size_t size) noexcept;
+        bool isNull() const noexcept;
+    };
+    
+    /*
+     *  Blobs are bound and read as std::vector<unsigned char>, or OSBlobView.
+     *  OSZeroBlob binds size zero bytes, to be filled by an OSBlobWriter.
+     */
+    struct OSZeroBlob {
+        size_t size;
+        
+        explicit OSZeroBlob(size_t size) noexcept;
+    };
+    
+    /*
+     *  OSNullable, a value which can be NULL, for results, bindings and keys.
+     */
+    template <typename T>
+    class OSNullable {
+    public:
+        OSNullable();
+        OSNullable(const T& value);
+        
+        bool isNull() const noexcept;
+        const T& value() const noexcept;
+        void setValue(const T& value);
+        void setNull() noexcept;
+    };
+    
+    /*
+     *  OSColumn<T>, a column vector returned by OSStatement::executeColumns,
+     *  aligned to OSQLITE_COLUMN_ALIGNMENT bytes by OSAlignedAllocator.
+     */
+    template <typename T>
+    using OSColumn = std::vector<T, OSAlignedAllocator<T>>;
+    
+    /*
+     *  OSMemoryPool, a thread-safe size-class pool (16 to 4096 bytes). After
+     *  configure() SQLite allocates from it (SQLITE_CONFIG_MALLOC), and a
+     *  page cache buffer and lookaside can be set up too. Call configure()
+     *  before opening any database. OSPoolAllocator<T> uses it for C++
+     *  containers, e.g. the rows of OSStatement::executeRows.
+     */
+    struct OSMemoryOptions {
+        bool pool;
+        size_t pageCacheSlotSize;
+        size_t pageCacheSlots;
+        int lookasideSlotSize;
+        int lookasideSlots;
+    };
+    struct OSMemoryStatistics {
+        unsigned long long allocations, frees, largeAllocations;
+        size_t bytesInUse, peakBytesInUse, bytesReserved;
+        long long sqliteMemoryUsed, sqliteMemoryHighwater, pageCacheUsed, pageCacheOverflow;
+    };
+    class OSMemoryPool {
+    public:
+        static void configure(const OSMemoryOptions& options = OSMemoryOptions()) throw(OSException);
+        static OSMemoryStatistics statistics() noexcept;
+        static void* allocate(size_t size) noexcept;
+        static void deallocate(void* pointer) noexcept;
+        static void* reallocate(void* pointer, size_t size) noexcept;
+        static size_t size(void* pointer) noexcept;
+    };
+    template <typename T>
+    struct OSPoolAllocator;
+    
+    /*
+     *  OSReduce, vectorizable reductions over columns (or any vector).
+     *  min and max throw OSException on an empty column.
+     */
+    struct OSReduce {
+        template <typename T, typename A> static double_or_long_long sum(const std::vector<T, A>& column);
+        template <typename T, typename A> static T min(const std::vector<T, A>& column) throw(OSException);
+        template <typename T, typename A> static T max(const std::vector<T, A>& column) throw(OSException);
+        template <typename T, typename A, typename Predicate> static size_t countWhere(const std::vector<T, A>& column, Predicate predicate);
+    };
+    
     /*
      *  OSTablePolicy. Policy class at compile-time key bindings for tables.
      *  Inherit this class to perform object operations:
@@ -42,7 +148,9 @@ namespace OSQLite {
      *  The template is to assure type-only.
      *  Use inheritance ctor like CTOR():OSTablePolicy("Person", {"id", "name"}, _id, _name)
      *  Binding variable type supported: int, unsigned int, long, unsigned long, 
-     *  float, double, std::string
+     *  float, double, std::string, OSNullable<T> of those
+     *  The table is registered once per type (thread-safe) by the first object;
+     *  objects carry no binding data and cost no allocation.
      */
     template <_DerivedCLS_>
     class OSTablePolicy {
@@ -57,6 +165,15 @@ namespace OSQLite {
         bool checkBindings();
     };
     
+    /*
+     *  OSBatchTiming, reported by the OSQuery bulk operations for every batch,
+     *  and by OSStatement::executeMany.
+     */
+    struct OSBatchTiming {
+        size_t rows;
+        std::chrono::microseconds elapsed;
+    };
+    
     /*
      *  OSQuery class, execute SQL with an object-oriented operations.
      *  Similar to Hibernate in Java.
@@ -73,14 +190,48 @@ namespace OSQLite {
          * fill: query and assign other key values given primary key.
          * update: update data given primary key.
          * savaOrUpdate: if the record exists (given primary key), then update; or save.
+         *     Returns true if a new record was saved. Usually one statement, no exists check.
          * deleteObject: delete object given primary key.
+         * fill and exists are answered from the object cache of the OSDatabase,
+         * when enabled.
          */
         template <typename Table> void save(Table& table) throw(OSException);
         template <typename Table> bool exists(Table& table) throw(OSException);
         template <typename Table> bool fill(Table& table) throw(OSException);
         template <typename Table> void update(Table& table) throw(OSException);
-        template <typename Table> void saveOrUpdate(Table& table) throw(OSException);
+        template <typename Table> bool saveOrUpdate(Table& table) throw(OSException);
         template <typename Table> void deleteObject(Table& table) throw(OSException);
+        
+        /* Bulk functions over a range of objects (or pointers to objects):
+         * saveAll, updateAll, deleteAll: the same as save, update, deleteObject,
+         * with one prepared statement and one transaction per batchSize
+         * objects (0: the whole range). Returns the timing of each batch.
+         */
+        template <typename Range> std::vector<OSBatchTiming> saveAll(Range& range, size_t batchSize = 0) throw(OSException);
+        template <typename Range> std::vector<OSBatchTiming> updateAll(Range& range, size_t batchSize = 0) throw(OSException);
+        template <typename Range> std::vector<OSBatchTiming> deleteAll(Range& range, size_t batchSize = 0) throw(OSException);
+    };
+    
+    /*
+     *  OSCursor, returned by OSStatement::executeCursor. Rows are read lazily
+     *  as sqlite3_step advances. Use it in a range-based for, or call next()
+     *  and row(). Destroying it (e.g. breaking out of the loop) stops the scan.
+     */
+    template <typename... Returns>
+    class OSCursor {
+    public:
+        class iterator;// Input iterator, dereferences to std::tuple<Returns...>
+        
+        OSCursor(OSCursor&& other) noexcept;
+        ~OSCursor();
+        
+        // Step to the next row. Returns false when there are no more rows.
+        bool next() throw(OSException);
+        // The current row.
+        const std::tuple<Returns...>& row() const noexcept;
+        
+        iterator begin() throw(OSException);
+        iterator end() noexcept;
     };
     
     /*
@@ -93,21 +244,46 @@ namespace OSQLite {
         virtual ~OSStatement();
         
         // Unified execute function, and throw OSException if got a failure.
-        // No returns, sql execution with bindings
+        // No returns, sql execution with bindings. Any argument can be bound:
+        // const values, temporaries, string literals, OSTextView. Text and
+        // blobs are not copied, except by executeCursor.
         template <typename... Args>
-        void execute(const std::string& sqlString, Args&...) throw(OSException);
-        // No return, no bindings; just execute SQL.
+        void execute(const std::string& sqlString, const Args&...) throw(OSException);
+        // No return, no bindings; just execute SQL (several statements too).
         void execute(const std::string& sqlString) throw(OSException);
         
         // Returns a std::vector containing tuples, each tuple is a row of data
         template <typename... Returns, typename... Args>
-        std::vector<std::tuple<Returns...>> executeRows(const std::string& sqlString, Args&...) throw (OSException);
+        std::vector<std::tuple<Returns...>> executeRows(const std::string& sqlString, const Args&...) throw (OSException);
+        // The same, appending to a vector with the caller's allocator.
+        template <typename... Returns, typename Allocator, typename... Args>
+        void executeRows(std::vector<std::tuple<Returns...>, Allocator>& rows, const std::string& sqlString, const Args&...) throw (OSException);
+        
+        // Returns a cursor reading the rows lazily, each row is a tuple.
+        template <typename... Returns, typename... Args>
+        OSCursor<Returns...> executeCursor(const std::string& sqlString, const Args&...) throw (OSException);
+        
+        // Returns the result by columns: a tuple of one aligned vector per column.
+        template <typename... Columns, typename... Args>
+        std::tuple<OSColumn<Columns>...> executeColumns(const std::string& sqlString, const Args&...) throw (OSException);
         
         // Also we provide one interface executing SQL and return a scalar
         // value, e.g. select count(*). They will throw OSException if
         // got a failure.
         template <typename R, typename... Args>
-        R executeScalar(const std::string& sqlString, Args&...) throw(OSException);
+        R executeScalar(const std::string& sqlString, const Args&...) throw(OSException);
+        
+        // Execute sqlString once per tuple of parameters, with one prepared
+        // statement, e.g. executeMany("insert into Person values(?, ?)", rows)
+        // with rows a std::vector<std::tuple<int, std::string>>. With
+        // transaction, the rows are written in one savepoint (a transaction,
+        // or nested in the open one) and rolled back together on failure.
+        // Returns the rows written and the time taken.
+        template <typename... Args>
+        OSBatchTiming executeMany(const std::string& sqlString, const std::vector<std::tuple<Args...>>& rows, bool transaction = true) throw(OSException);
+        // The same over an input range of tuples.
+        template <typename InputIterator>
+        OSBatchTiming executeMany(const std::string& sqlString, InputIterator first, InputIterator last, bool transaction = true) throw(OSException);
         
         // Interfaces for transactions
         inline void begin() throw(OSException);
@@ -116,6 +292,140 @@ namespace OSQLite {
         inline void rollback() throw(OSException);
     };
     
+    /*
+     *  OSBlobHandle, OSBlobReader and OSBlobWriter, incremental blob I/O in
+     *  chunks (sqlite3_blob_open) on table.column of one rowid. A blob cannot
+     *  grow; a change of the row by another statement expires the handle.
+     */
+    class OSBlobHandle {
+    public:
+        virtual ~OSBlobHandle();
+        size_t size() const noexcept;
+        size_t position() const noexcept;
+        size_t remaining() const noexcept;
+        void seek(size_t position) throw(OSException);
+        void reopen(sqlite3_int64 rowid) throw(OSException);
+    };
+    class OSBlobReader : public OSBlobHandle {
+    public:
+        OSBlobReader(const OSDatabase& database, const std::string& table, const std::string& column, sqlite3_int64 rowid, const std::string& schema = "main") throw(OSException);
+        // Returns the bytes read, 0 at the end.
+        size_t read(void* buffer, size_t size) throw(OSException);
+    };
+    class OSBlobWriter : public OSBlobHandle {
+    public:
+        OSBlobWriter(const OSDatabase& database, const std::string& table, const std::string& column, sqlite3_int64 rowid, const std::string& schema = "main") throw(OSException);
+        void write(const void* data, size_t size) throw(OSException);
+        void write(const OSBlobView& data) throw(OSException);
+    };
+    
+    /*
+     *  OSLatencyHistogram, lock-free log-linear histogram of latencies.
+     */
+    class OSLatencyHistogram {
+    public:
+        void record(std::chrono::nanoseconds latency) noexcept;
+        void reset() noexcept;
+        unsigned long long count() const noexcept;
+        std::chrono::nanoseconds mean() const noexcept;
+        std::chrono::nanoseconds percentile(double quantile) const noexcept;
+    };
+    
+    /*
+     *  OSStatementMetrics, counters of one SQL fingerprint (literals replaced
+     *  by '?'), and OSMetricsSnapshot, returned by OSDatabase::metrics().
+     *  A batch of executeMany or executeAll is one execution.
+     */
+    struct OSStatementMetrics {
+        std::string fingerprint;
+        unsigned long long executions, prepares, rows, vmSteps, fullScanSteps, sorts, autoIndexes;
+        std::chrono::nanoseconds mean, p50, p99, p999;
+    };
+    struct OSMetricsSnapshot {
+        std::vector<OSStatementMetrics> statements;
+        OSStatementMetrics total;
+        unsigned long long statementCacheHits, statementCacheMisses;
+        int pageCacheHits, pageCacheMisses, pageCacheWrites;
+        int pageCacheMemory, schemaMemory, statementMemory, lookasideUsed;
+    };
+    
+    /*
+     *  OSSlowQuery, an entry of the slow-query log: the SQL, the SQL with its
+     *  bound parameters, the time it took and its EXPLAIN QUERY PLAN, with
+     *  full table scans and temporary b-trees flagged.
+     */
+    struct OSSlowQuery {
+        std::string sqlString;
+        std::string expandedSQL;
+        std::chrono::nanoseconds elapsed;
+        std::vector<std::string> queryPlan;
+        bool fullScan;
+        bool tempBTree;
+    };
+    
+    /*
+     *  OSStatementCache, a LRU cache of prepared sqlite3_stmt handles keyed by
+     *  SQL text. Each OSDatabase owns one, and OSStatement executes through it.
+     *  Default capacity is OSQLITE_STATEMENT_CACHE_CAPACITY. Thread-safe.
+     */
+    class OSStatementCache {
+    public:
+        // Get a prepared statement for the SQL / give it back after use.
+        int acquire(const std::string& sqlString, sqlite3_stmt** statement, bool single = false) noexcept;
+        void release(const std::string& sqlString, sqlite3_stmt* statement) noexcept;
+        // sqlite3_step, counting rows for metrics.
+        int step(sqlite3_stmt* statement) noexcept;
+        // Finalize all idle statements.
+        void clear() noexcept;
+        
+        // Capacity 0 disables caching.
+        void setCapacity(size_t capacity) noexcept;
+        size_t capacity() const noexcept;
+        size_t size() const noexcept;
+        unsigned long long hits() const noexcept;
+        unsigned long long misses() const noexcept;
+    };
+    
+    /*
+     *  OSObjectCacheStatistics, counters of the object cache of an OSDatabase.
+     */
+    struct OSObjectCacheStatistics {
+        unsigned long long hits;
+        unsigned long long misses;
+        unsigned long long evictions;
+        unsigned long long invalidations;
+        size_t entries;
+        size_t bytes;
+        size_t memoryBudget;
+        
+        double hitRate() const noexcept;
+    };
+    
+    /*
+     *  OSDatabaseOptions, how an OSDatabase is opened and tuned. Fields left
+     *  at their "keep" value are not touched. Named profiles: oltp(),
+     *  bulkLoad() (not durable), readOnlyAnalytics() (memory-mapped) and
+     *  inMemoryMirror() (the file loaded into memory, flushed back).
+     */
+    struct OSDatabaseOptions {
+        int openFlags;
+        std::string journalMode;
+        int synchronous;
+        long long cacheSize;
+        long long mmapSize;
+        int tempStore;
+        int pageSize;
+        int queryOnly;
+        int busyTimeout;
+        bool mirror;
+        std::chrono::milliseconds flushInterval;
+        
+        static OSDatabaseOptions oltp() noexcept;
+        static OSDatabaseOptions bulkLoad() noexcept;
+        static OSDatabaseOptions readOnlyAnalytics() noexcept;
+        static OSDatabaseOptions inMemoryMirror(std::chrono::milliseconds flushInterval = std::chrono::milliseconds(1000)) noexcept;
+    };
+    
     /*
      *  OSDatabase class, control the access to SQLite database.
      *  Follow the RAII principle, the database is opened and closed when you
@@ -124,6 +434,191 @@ namespace OSQLite {
     class OSDatabase {
     public:
         OSDatabase(const std::string& dbName) throw(OSException);
+        // Open with sqlite3_open_v2 flags, e.g. SQLITE_OPEN_READONLY.
+        OSDatabase(const std::string& dbName, int openFlags) throw(OSException);
+        OSDatabase(const std::string& dbName, const OSDatabaseOptions& options) throw(OSException);
         virtual ~OSDatabase();
+        
+        // The prepared statement cache used on this connection.
+        OSStatementCache& statementCache() const noexcept;
+        
+        // Rowid of the last insert on this connection.
+        sqlite3_int64 lastInsertRowid() const noexcept;
+        
+        // Switch the tuning at runtime, e.g. to OSDatabaseOptions::bulkLoad().
+        void applyOptions(const OSDatabaseOptions& options) throw(OSException);
+        
+        // Statement metrics: per fingerprint counters and latency histograms
+        // of every OSStatement and OSQuery path. Off by default, then they
+        // cost one branch per statement.
+        void enableMetrics(bool enable = true) noexcept;
+        bool metricsEnabled() const noexcept;
+        OSMetricsSnapshot metrics() const;
+        
+        // Log statements taking at least threshold (newest capacity kept).
+        void enableSlowQueryLog(std::chrono::microseconds threshold, size_t capacity = 128, std::function<void(const OSSlowQuery&)> callback = nullptr);
+        void disableSlowQueryLog() noexcept;
+        std::vector<OSSlowQuery> slowQueries() const;
+        
+        // Hot backup to a file, or restore from one, on a background thread
+        // in steps of pagesPerStep pages with a pause of sleep between them.
+        std::unique_ptr<OSBackup> backupTo(const std::string& filePath, int pagesPerStep = 100, std::chrono::milliseconds sleep = std::chrono::milliseconds(10), std::function<void(const OSBackupProgress&)> progress = nullptr) throw(OSException);
+        std::unique_ptr<OSBackup> restoreFrom(const std::string& filePath, int pagesPerStep = 100, std::chrono::milliseconds sleep = std::chrono::milliseconds(10), std::function<void(const OSBackupProgress&)> progress = nullptr) throw(OSException);
+        
+        // Mirror mode: write the in-memory database to its file now, as it
+        // is also done every flushInterval and when closed.
+        void flush() throw(OSException);
+        bool isMirror() const noexcept;
+        
+        // Listen to the rows changed through this connection (update hook).
+        size_t addUpdateListener(std::function<void(int operation, const char* databaseName, const char* table, sqlite3_int64 rowid)> listener);
+        void removeUpdateListener(size_t id) noexcept;
+        
+        // Identity map of OSQuery::fill and exists, in LRU order within
+        // memoryBudget bytes. Writes through this connection drop their rows;
+        // writes by other connections are not seen.
+        void enableObjectCache(size_t memoryBudget = 4194304);
+        void disableObjectCache() noexcept;
+        void invalidateObjectCache() noexcept;
+        OSObjectCacheStatistics objectCacheStatistics() const noexcept;
+    };
+    
+    /*
+     *  OSBackup, a running backup or restore (sqlite3_backup). Writers of the
+     *  source are not stalled: changes through another connection restart
+     *  it, changes through the same one are copied too. Destroy it before its
+     *  OSDatabase; destroying it cancels the backup.
+     */
+    struct OSBackupProgress {
+        int remaining, pageCount;
+        double fraction() const noexcept;
+    };
+    class OSBackup {
+    public:
+        virtual ~OSBackup();
+        
+        // false if cancelled, throws if failed.
+        bool wait() throw(OSException);
+        void cancel() noexcept;
+        bool finished() const noexcept;
+        OSBackupProgress progress() const noexcept;
+    };
+    
+    /*
+     *  OSPooledDatabase, a connection checked out of an OSDatabasePool. It is
+     *  given back when destroyed. Use it as an OSDatabase.
+     */
+    class OSPooledDatabase {
+    public:
+        OSPooledDatabase(OSPooledDatabase&& other) noexcept;
+        ~OSPooledDatabase();
+        
+        OSDatabase& operator*() const noexcept;
+        OSDatabase* operator->() const noexcept;
+        bool isWriter() const noexcept;
+    };
+    
+    /*
+     *  OSDatabasePool, a thread-safe pool of one writer and readerCount
+     *  read-only connections to a database in WAL mode. acquire(sql) sends
+     *  read-only SQL to a reader and the rest to the writer.
+     */
+    class OSDatabasePool {
+    public:
+        OSDatabasePool(const std::string& dbName, size_t readerCount) throw(OSException);
+        virtual ~OSDatabasePool();
+        
+        OSPooledDatabase reader() throw(OSException);
+        OSPooledDatabase writer() throw(OSException);
+        OSPooledDatabase acquire(const std::string& sqlString) throw(OSException);
+        size_t readerCount() const noexcept;
+    };
+    
+    /*
+     *  OSAsyncDatabase, runs the work on its own connection in a worker
+     *  thread and returns futures. Work runs in submission order, and submit
+     *  blocks while queueCapacity submissions are waiting. SQL arguments are
+     *  copied; OSQuery objects must live until the future is ready.
+     */
+    class OSAsyncDatabase {
+    public:
+        OSAsyncDatabase(const std::string& dbName, const OSDatabaseOptions& options = OSDatabaseOptions(), size_t queueCapacity = 1024) throw(OSException);
+        virtual ~OSAsyncDatabase();
+        
+        // Run task(OSDatabase&) on the worker, the result goes to the future
+        // or to callback(std::future).
+        template <typename Task>
+        std::future<typename std::result_of<Task(OSDatabase&)>::type> submit(Task task) throw(OSException);
+        template <typename Task, typename Callback>
+        void submit(Task task, Callback callback) throw(OSException);
+        
+        template <typename... Args>
+        std::future<void> execute(const std::string& sqlString, const Args&... args) throw(OSException);
+        template <typename... Returns, typename... Args>
+        std::future<std::vector<std::tuple<Returns...>>> executeRows(const std::string& sqlString, const Args&... args) throw(OSException);
+        template <typename R, typename... Args>
+        std::future<R> executeScalar(const std::string& sqlString, const Args&... args) throw(OSException);
+        
+        template <typename Table> std::future<void> save(Table& table) throw(OSException);
+        template <typename Table> std::future<bool> exists(Table& table) throw(OSException);
+        template <typename Table> std::future<bool> fill(Table& table) throw(OSException);
+        template <typename Table> std::future<void> update(Table& table) throw(OSException);
+        template <typename Table> std::future<bool> saveOrUpdate(Table& table) throw(OSException);
+        template <typename Table> std::future<void> deleteObject(Table& table) throw(OSException);
+        
+        size_t pending() noexcept;
+        size_t queueCapacity() const noexcept;
+    };
+    
+    /*
+     *  OSGroupCommitQueue, coalesces the writes of many threads. Writes are
+     *  queued lock-free and one writer thread commits them in batches of up
+     *  to maxBatch, or those within window. The future is ready when the
+     *  batch is committed; a failed write does not undo the others, unless
+     *  SQLite rolls the transaction back, which fails the batch so far.
+     */
+    class OSGroupCommitQueue {
+    public:
+        OSGroupCommitQueue(const std::string& dbName, size_t maxBatch = 256, std::chrono::microseconds window = std::chrono::microseconds(2000), const OSDatabaseOptions& options = OSDatabaseOptions::oltp()) throw(OSException);
+        virtual ~OSGroupCommitQueue();
+        
+        std::future<void> submit(std::function<void(OSDatabase&)> write) throw(OSException);
+        template <typename... Args>
+        std::future<void> execute(const std::string& sqlString, const Args&... args) throw(OSException);
+        
+        unsigned long long batches() const noexcept;
+        unsigned long long operations() const noexcept;
+    };
+    
+    /*
+     *  OSBulkLoader, imports a delimited (CSV) or fixed-width file into a
+     *  table. The file is memory-mapped, parser threads scan it 8 bytes at a
+     *  time and hand batches of rows to the calling thread, which inserts them
+     *  in large transactions with OSDatabaseOptions::bulkLoad() pragmas.
+     */
+    enum class OSFieldType {text, integer, real};
+    struct OSBulkLoadStatistics {
+        size_t rows, batches, transactions, bytes;
+        std::chrono::microseconds elapsed;
+        double rowsPerSecond() const noexcept;
+    };
+    struct OSBulkLoadOptions {
+        char delimiter = ',';
+        char quote = '"';
+        bool header = false;
+        std::vector<size_t> fieldWidths;
+        size_t batchSize = 8192;
+        size_t transactionSize = 1000000;
+        size_t parserThreads = 1;
+        size_t queueCapacity = 8;
+        bool bulkPragmas = true;
+        std::function<void(const OSBulkLoadStatistics&)> progress;
+    };
+    class OSBulkLoader {
+    public:
+        OSBulkLoader(OSDatabase& database, const std::string& table, const std::vector<std::string>& columns, const std::vector<OSFieldType>& types, const OSBulkLoadOptions& options = OSBulkLoadOptions()) throw(OSException);
+        virtual ~OSBulkLoader();
+        
+        OSBulkLoadStatistics load(const std::string& filePath) throw(OSException);
     };
-}
\ No newline at end of file
+}
@@ -15,12 +15,46 @@
 #include <sstream>
 #include <exception>
 #include <utility>
+#include <iterator>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <future>
+#include <functional>
+#include <algorithm>
+#include <cmath>
 // STL Containers
 #include <vector>
+#include <list>
+#include <deque>
 #include <unordered_map>
 #include <tuple>
 
 #include <assert.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+// Memory-mapped files of OSMappedFile
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif
+#include <windows.h>
+#else
+// Memory-mapped files of OSMappedFile
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #ifndef _MSC_VER
 // XCODE
@@ -46,15 +80,67 @@
 #define BEGIN_EXCLUSIVE std::string(" EXCLUSIVE")
 #define BEGIN_NONE std::string("")
 
+// Alignment in bytes of the column vectors returned by executeColumns.
+#ifndef OSQLITE_COLUMN_ALIGNMENT
+#define OSQLITE_COLUMN_ALIGNMENT 64
+#endif
+
+// Default number of idle prepared statements kept per connection by the
+// OSStatementCache. Define it before including this header to override.
+#ifndef OSQLITE_STATEMENT_CACHE_CAPACITY
+#define OSQLITE_STATEMENT_CACHE_CAPACITY 32
+#endif
+
 // Namespace
 namespace OSQLite {
     class OSException;
-    struct OSPlaceHolder;
+    struct OSTextView;
+    struct OSBlobView;
+    struct OSZeroBlob;
+    template <typename T>
+    class OSNullable;
+    template <typename T, size_t Alignment>
+    struct OSAlignedAllocator;
+    struct OSMemoryOptions;
+    struct OSMemoryStatistics;
+    class OSMemoryPool;
+    template <typename T>
+    struct OSPoolAllocator;
+    struct OSReduce;
     template <class _Derived_>
     class OSTablePolicy;
+    struct OSBatchTiming;
     class OSQuery;
+    template <typename... Returns>
+    class OSCursor;
     class OSStatement;
+    class OSBlobHandle;
+    class OSBlobReader;
+    class OSBlobWriter;
+    class OSLatencyHistogram;
+    struct OSStatementMetrics;
+    struct OSMetricsSnapshot;
+    class OSMetrics;
+    struct OSSlowQuery;
+    class OSSlowQueryLog;
+    class OSStatementCache;
+    struct OSObjectRowOps;
+    struct OSObjectCacheStatistics;
+    class OSObjectCache;
+    struct OSDatabaseOptions;
     class OSDatabase;
+    struct OSBackupProgress;
+    class OSBackup;
+    class OSMirror;
+    class OSPooledDatabase;
+    class OSDatabasePool;
+    class OSAsyncDatabase;
+    class OSGroupCommitQueue;
+    class OSMappedFile;
+    enum class OSFieldType;
+    struct OSBulkLoadStatistics;
+    struct OSBulkLoadOptions;
+    class OSBulkLoader;
     
     /*
      *  OSException class, inherited from std::exception.
@@ -73,22 +159,261 @@ namespace OSQLite {
     };
     
     /*
-     *  OSTablePolicy. Policy class for run-time key bindings for tables.
-     *  Thus, RTTI is needed.
+     *  OSTextView and OSBlobView, zero-copy result types of text and blob
+     *  columns. They point into the buffer SQLite keeps for the current row,
+     *  so no allocation or copy is made, and they are valid only until the
+     *  next step of the statement. Use them with OSStatement::executeCursor.
+     *  A NULL column gives a view with isNull() true.
+     */
+    struct OSTextView {
+        const char* data = nullptr;
+        size_t size = 0;
+        
+        inline bool isNull() const noexcept;
+        inline std::string str() const;
+        inline bool operator==(const std::string& other) const noexcept;
+        inline bool operator!=(const std::string& other) const noexcept;
+    };
+    struct OSBlobView {
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        
+        OSBlobView() = default;
+        // A view of size bytes at data, e.g. to bind a buffer without copying
+        // it into a vector first.
+        OSBlobView(const void* data, size_t size) noexcept;
+        
+        inline bool isNull() const noexcept;
+    };
+    
+    /*
+     *  Blobs are bound and read as std::vector<unsigned char> (uint8_t), or
+     *  as OSBlobView. OSZeroBlob binds a blob of size zero bytes without any
+     *  buffer (sqlite3_bind_zeroblob), the space to fill with an OSBlobWriter.
+     */
+    struct OSZeroBlob {
+        size_t size;
+        
+        explicit OSZeroBlob(size_t size) noexcept;
+    };
+    
+    /*
+     *  OSNullable, a value which can be NULL in the database, for results,
+     *  parameter bindings and OSTablePolicy keys. T can be any supported type.
+     *  Without it, NULL comes back as 0 or an empty string.
+     */
+    template <typename T>
+    class OSNullable {
+        T _value;
+        bool _null;
+    public:
+        OSNullable();
+        OSNullable(const T& value);
+        
+        inline bool isNull() const noexcept;
+        inline const T& value() const noexcept;
+        inline void setValue(const T& value);
+        inline void setNull() noexcept;
+    };
+    
+    /*
+     *  OSAlignedAllocator, allocates Alignment-aligned memory so that columns
+     *  start on a cache line and suit vectorized loops.
+     *  OSColumn<T> is the column vector returned by OSStatement::executeColumns.
+     */
+    template <typename T, size_t Alignment = OSQLITE_COLUMN_ALIGNMENT>
+    struct OSAlignedAllocator {
+        typedef T value_type;
+        template <typename U>
+        struct rebind {typedef OSAlignedAllocator<U, Alignment> other;};
+        
+        OSAlignedAllocator() noexcept {}
+        template <typename U>
+        OSAlignedAllocator(const OSAlignedAllocator<U, Alignment>&) noexcept {}
+        
+        inline T* allocate(size_t count);
+        inline void deallocate(T* pointer, size_t count) noexcept;
+        
+        template <typename U>
+        inline bool operator==(const OSAlignedAllocator<U, Alignment>&) const noexcept {return true;}
+        template <typename U>
+        inline bool operator!=(const OSAlignedAllocator<U, Alignment>&) const noexcept {return false;}
+    };
+    template <typename T>
+    using OSColumn = std::vector<T, OSAlignedAllocator<T>>;
+    
+    /*
+     *  OSMemoryOptions, what OSMemoryPool::configure installs in SQLite:
+     *      pool            serve every SQLite allocation from OSMemoryPool
+     *                      (SQLITE_CONFIG_MALLOC).
+     *      pageCacheSlotSize, pageCacheSlots
+     *                      one preallocated buffer for the page cache
+     *                      (SQLITE_CONFIG_PAGECACHE). A slot holds a page and
+     *                      its header: use page size + 64. 0 keeps it off.
+     *      lookasideSlotSize, lookasideSlots
+     *                      per connection lookaside for small objects
+     *                      (SQLITE_CONFIG_LOOKASIDE). -1 keeps the default.
+     */
+    struct OSMemoryOptions {
+        bool pool = true;
+        size_t pageCacheSlotSize = 0;
+        size_t pageCacheSlots = 0;
+        int lookasideSlotSize = -1;
+        int lookasideSlots = -1;
+    };
+    
+    /*
+     *  OSMemoryStatistics, returned by OSMemoryPool::statistics(). Pool
+     *  counters cover SQLite (once configured) and OSPoolAllocator; the
+     *  sqlite fields are from sqlite3_status.
+     */
+    struct OSMemoryStatistics {
+        unsigned long long allocations = 0;
+        unsigned long long frees = 0;
+        // Allocations bigger than the largest size class, passed to malloc.
+        unsigned long long largeAllocations = 0;
+        size_t bytesInUse = 0;
+        size_t peakBytesInUse = 0;
+        // Memory taken from malloc for the size classes, never given back.
+        size_t bytesReserved = 0;
+        long long sqliteMemoryUsed = 0;
+        long long sqliteMemoryHighwater = 0;
+        long long pageCacheUsed = 0;
+        long long pageCacheOverflow = 0;
+    };
+    
+    /*
+     *  OSMemoryPool, a thread-safe size-class pool: power of two classes from
+     *  16 to 4096 bytes, carved from 64 KiB chunks, with one free list and
+     *  lock per class. Larger blocks go to malloc. It serves SQLite after
+     *  configure(), and C++ containers through OSPoolAllocator.
+     *  configure() shuts SQLite down and starts it again with the options,
+     *  so call it before opening any OSDatabase (it throws SQLITE_MISUSE if
+     *  a connection of OSQLite is open; ones opened by hand are not known).
+     */
+    class OSMemoryPool {
+        friend class OSDatabase;
+        friend class OSBackup;
+        friend class OSMirror;
+        
+        struct State;
+        static inline State& state() noexcept;
+        static inline size_t sizeClass(size_t size) noexcept;
+        
+        // sqlite3_mem_methods
+        static inline void* sqliteMalloc(int size);
+        static inline void sqliteFree(void* pointer);
+        static inline void* sqliteRealloc(void* pointer, int size);
+        static inline int sqliteSize(void* pointer);
+        static inline int sqliteRoundup(int size);
+        static inline int sqliteInit(void*);
+        static inline void sqliteShutdown(void*);
+        
+        // Around each sqlite3_open_v2 and sqlite3_close of OSQLite.
+        static inline void connectionOpened() noexcept;
+        static inline void connectionClosed() noexcept;
+        
+    public:
+        static inline void configure(const OSMemoryOptions& options = OSMemoryOptions()) throw(OSException);
+        static inline OSMemoryStatistics statistics() noexcept;
+        
+        // 16-byte aligned blocks, nullptr when out of memory.
+        static inline void* allocate(size_t size) noexcept;
+        static inline void deallocate(void* pointer) noexcept;
+        static inline void* reallocate(void* pointer, size_t size) noexcept;
+        // Usable size of a block.
+        static inline size_t size(void* pointer) noexcept;
+    };
+    
+    /*
+     *  OSPoolAllocator, a standard allocator on OSMemoryPool, e.g. for the
+     *  rows of OSStatement::executeRows(rows, ...).
+     */
+    template <typename T>
+    struct OSPoolAllocator {
+        typedef T value_type;
+        template <typename U>
+        struct rebind {typedef OSPoolAllocator<U> other;};
+        
+        OSPoolAllocator() noexcept {}
+        template <typename U>
+        OSPoolAllocator(const OSPoolAllocator<U>&) noexcept {}
+        
+        inline T* allocate(size_t count);
+        inline void deallocate(T* pointer, size_t count) noexcept;
+        
+        template <typename U>
+        inline bool operator==(const OSPoolAllocator<U>&) const noexcept {return true;}
+        template <typename U>
+        inline bool operator!=(const OSPoolAllocator<U>&) const noexcept {return false;}
+    };
+    
+    /*
+     *  OSReduce, reductions over columns (or any contiguous vector) written as
+     *  plain counted loops with independent accumulators, so the compiler
+     *  can vectorize them. min and max throw OSException on an empty column.
+     */
+    struct OSReduce {
+        template <typename T, typename A>
+        static inline typename std::conditional<std::is_floating_point<T>::value, double, long long>::type sum(const std::vector<T, A>& column);
+        template <typename T, typename A>
+        static inline T min(const std::vector<T, A>& column) throw(OSException);
+        template <typename T, typename A>
+        static inline T max(const std::vector<T, A>& column) throw(OSException);
+        template <typename T, typename A, typename Predicate>
+        static inline size_t countWhere(const std::vector<T, A>& column, Predicate predicate);
+    };
+    
+    /*
+     *  OSTablePolicy. Policy class for compile-time key bindings for tables.
      *  Inherit this class to perform object operations:
      *  e.g. clas DerivedObject : public OSTablePolicy<DerivedObject>
      *  The template is to assure type-only.
      *  Binding variable type supported: int, unsigned int, long, unsigned long,
-     *  float, double, std::string
+     *  float, double, std::string, OSNullable<T> of those
+     *
+     *  The first constructed object registers the table once per type (thread-
+     *  safe): key names, key offsets in the object and the binding functions
+     *  generated for the key types. Objects carry no binding data, so creating
+     *  one costs no allocation. Every object of the type must have the same
+     *  layout; do not construct further derived classes through the mapping.
      */
     template <class _Derived_>
     class OSTablePolicy {
         friend class OSQuery;
         
+        static std::once_flag _registration;
         static bool _hasBindings;
         static std::string _tableName;
         static std::vector<std::string> _keyNameVec;
-        OSPlaceHolder* _keyReference = nullptr;
+        static std::vector<ptrdiff_t> _keyOffsets;
+        static void (*_returnAssign)(char*, const ptrdiff_t*, sqlite3_stmt*);
+        static void (*_paramBinding)(const char*, const ptrdiff_t*, sqlite3_stmt*);
+        static void (*_keyBinding)(const char*, const ptrdiff_t*, sqlite3_stmt*, int);
+        
+        // Used by OSQuery: extract all keys, bind all keys (from parameter 1),
+        // bind the primary key at the index.
+        inline void queryReturnAssign(sqlite3_stmt* statement);
+        inline void queryParamBinding(sqlite3_stmt* statement) const;
+        inline void queryKeyBinding(sqlite3_stmt* statement, int index) const;
+        
+        // SQL used by OSQuery, generated once per table type when the keys
+        // are bound. The primary key is a parameter, so one plan serves all keys.
+        static std::string _saveSQL;
+        static std::string _existsSQL;
+        static std::string _fillSQL;
+        static std::string _updateSQL;
+        static std::string _deleteSQL;
+        static void generateSQL();
+        
+        // Used by OSQuery with the object cache of the connection: the table
+        // name as the cache knows it, how rows are kept, the cache key of the
+        // primary key, and the copy of the object from or into the cache.
+        static std::string _cacheTable;
+        static const OSObjectRowOps* _rowOps;
+        inline std::string queryCacheKey() const;
+        inline bool queryCacheLookup(OSObjectCache& cache, const std::string& key);
+        inline void queryCacheStore(OSObjectCache& cache, const std::string& key, unsigned long long generation) const;
         
     protected:
         // Bind keys when constructing
@@ -102,9 +427,30 @@ namespace OSQLite {
         // A function you can check if your bindings are acceptable.
         bool checkBindings();
     };
+    template <class _Derived_> std::once_flag OSTablePolicy<_Derived_>::_registration;
     template <class _Derived_> bool OSTablePolicy<_Derived_>::_hasBindings = false;
     template <class _Derived_> std::string OSTablePolicy<_Derived_>::_tableName = "";
     template <class _Derived_> std::vector<std::string> OSTablePolicy<_Derived_>::_keyNameVec;
+    template <class _Derived_> std::vector<ptrdiff_t> OSTablePolicy<_Derived_>::_keyOffsets;
+    template <class _Derived_> void (*OSTablePolicy<_Derived_>::_returnAssign)(char*, const ptrdiff_t*, sqlite3_stmt*) = nullptr;
+    template <class _Derived_> void (*OSTablePolicy<_Derived_>::_paramBinding)(const char*, const ptrdiff_t*, sqlite3_stmt*) = nullptr;
+    template <class _Derived_> void (*OSTablePolicy<_Derived_>::_keyBinding)(const char*, const ptrdiff_t*, sqlite3_stmt*, int) = nullptr;
+    template <class _Derived_> std::string OSTablePolicy<_Derived_>::_saveSQL;
+    template <class _Derived_> std::string OSTablePolicy<_Derived_>::_existsSQL;
+    template <class _Derived_> std::string OSTablePolicy<_Derived_>::_fillSQL;
+    template <class _Derived_> std::string OSTablePolicy<_Derived_>::_updateSQL;
+    template <class _Derived_> std::string OSTablePolicy<_Derived_>::_deleteSQL;
+    template <class _Derived_> std::string OSTablePolicy<_Derived_>::_cacheTable;
+    template <class _Derived_> const OSObjectRowOps* OSTablePolicy<_Derived_>::_rowOps = nullptr;
+    
+    /*
+     *  OSBatchTiming, reported by the OSQuery bulk operations for every batch
+     *  (one transaction) they commit, and by OSStatement::executeMany.
+     */
+    struct OSBatchTiming {
+        size_t rows = 0;
+        std::chrono::microseconds elapsed = std::chrono::microseconds(0);
+    };
     
     /*
      *  OSQuery class, execute SQL with an object-oriented operations.
@@ -114,9 +460,16 @@ namespace OSQLite {
     class OSQuery {
         
         sqlite3* const& _connection;
+        OSStatementCache& _cache;
+        // Null unless OSDatabase::enableObjectCache was called.
+        const std::unique_ptr<OSObjectCache>& _objectCache;
         
         sqlite3_stmt* _statement = nullptr;
         
+        // Step one statement over a range in batches, see saveAll.
+        template <typename Range, typename Binding>
+        std::vector<OSBatchTiming> executeAll(Range& range, size_t batchSize, const std::string& sqlString, const std::string& name, Binding binding) throw(OSException);
+        
     public:
         OSQuery(const OSDatabase& database) throw(OSException);
         OSQuery(const OSQuery&) = delete;
@@ -129,14 +482,77 @@ namespace OSQLite {
          * fill: query and assign other key values given primary key.
          * update: update data given primary key.
          * savaOrUpdate: if the record exists (given primary key), then update; or save.
+         *     Returns true if a new record was saved. Usually one statement, no exists check.
          * deleteObject: delete object given primary key.
+         * With the object cache of the connection enabled, fill and exists are
+         * answered from it when they can, and the writes invalidate the key.
          */
         template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type save(Table& table) throw(OSException);
         template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type exists(Table& table) throw(OSException);
         template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type fill(Table& table) throw(OSException);
         template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type update(Table& table) throw(OSException);
-        template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type saveOrUpdate(Table& table) throw(OSException);
+        template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type saveOrUpdate(Table& table) throw(OSException);
         template <typename Table> typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type deleteObject(Table& table) throw(OSException);
+        
+        /* Bulk functions over a range of objects (or pointers to objects):
+         * saveAll, updateAll, deleteAll: the same as save, update, deleteObject.
+         * One prepared statement serves the whole range, and every batchSize
+         * objects are written in one transaction (0: the whole range at once).
+         * It works inside an open transaction too, as batches are savepoints.
+         * If a batch fails it is rolled back, but earlier batches are kept.
+         * Returns the timing of each batch.
+         */
+        template <typename Range> std::vector<OSBatchTiming> saveAll(Range& range, size_t batchSize = 0) throw(OSException);
+        template <typename Range> std::vector<OSBatchTiming> updateAll(Range& range, size_t batchSize = 0) throw(OSException);
+        template <typename Range> std::vector<OSBatchTiming> deleteAll(Range& range, size_t batchSize = 0) throw(OSException);
+    };
+    
+    /*
+     *  OSCursor, returned by OSStatement::executeCursor. Rows are read one at
+     *  a time as sqlite3_step advances, so memory does not grow with the
+     *  result. Use it in a range-based for, or call next() and row().
+     *  The statement goes back to the cache when all rows are read or the
+     *  cursor is destroyed; breaking out of the loop stops the scan.
+     *  A cursor must not outlive its OSDatabase.
+     */
+    template <typename... Returns>
+    class OSCursor {
+        friend class OSStatement;
+        
+        OSStatementCache* _cache;
+        std::string _sqlString;
+        sqlite3_stmt* _statement;
+        std::tuple<Returns...> _row;
+        bool _started = false;
+        
+        OSCursor(OSStatementCache& cache, const std::string& sqlString, sqlite3_stmt* statement) noexcept;
+        inline void finish() noexcept;
+        
+    public:
+        // Input iterator over the rows. Invalidated by next().
+        class iterator : public std::iterator<std::input_iterator_tag, std::tuple<Returns...>> {
+            OSCursor* _cursor;
+        public:
+            explicit iterator(OSCursor* cursor) noexcept;
+            inline const std::tuple<Returns...>& operator*() const noexcept;
+            inline const std::tuple<Returns...>* operator->() const noexcept;
+            inline iterator& operator++() throw(OSException);
+            inline bool operator==(const iterator& other) const noexcept;
+            inline bool operator!=(const iterator& other) const noexcept;
+        };
+        
+        OSCursor(OSCursor&& other) noexcept;
+        OSCursor(const OSCursor&) = delete;
+        OSCursor operator=(const OSCursor&) = delete;
+        ~OSCursor();
+        
+        // Step to the next row. Returns false when there are no more rows.
+        inline bool next() throw(OSException);
+        // The current row.
+        inline const std::tuple<Returns...>& row() const noexcept;
+        
+        inline iterator begin() throw(OSException);
+        inline iterator end() noexcept;
     };
     
     /*
@@ -146,6 +562,7 @@ namespace OSQLite {
     class OSStatement {
         
         sqlite3* const& _connection;
+        OSStatementCache& _cache;
         
         sqlite3_stmt* _statement = nullptr;
         
@@ -156,21 +573,51 @@ namespace OSQLite {
         virtual ~OSStatement();
         
         // Unified execute function, and throw OSException if got a failure.
-        // No returns, sql execution with bindings
+        // No returns, sql execution with bindings. Any argument can be bound:
+        // const values, temporaries, string literals, OSTextView. Text and
+        // blobs are not copied, except by executeCursor.
         template <typename... Args>
-        void execute(const std::string& sqlString, Args&...) throw(OSException);
-        // No return, no bindings; just execute SQL.
+        void execute(const std::string& sqlString, const Args&...) throw(OSException);
+        // No return, no bindings; just execute SQL. One statement goes
+        // through the statement cache like the others, a script of several
+        // is run by sqlite3_exec.
         void execute(const std::string& sqlString) throw(OSException);
         
         // Returns a std::vector containing tuples, each tuple is a row of data
         template <typename... Returns, typename... Args>
-        std::vector<std::tuple<Returns...>> executeRows(const std::string& sqlString, Args&...) throw (OSException);
+        std::vector<std::tuple<Returns...>> executeRows(const std::string& sqlString, const Args&...) throw (OSException);
+        // The same, appending to rows, so the caller chooses the allocator,
+        // e.g. OSPoolAllocator, and can reuse the vector.
+        template <typename... Returns, typename Allocator, typename... Args>
+        void executeRows(std::vector<std::tuple<Returns...>, Allocator>& rows, const std::string& sqlString, const Args&...) throw (OSException);
+        
+        // Returns a cursor reading the rows lazily, each row is a tuple.
+        // Several cursors can be open at the same time.
+        template <typename... Returns, typename... Args>
+        OSCursor<Returns...> executeCursor(const std::string& sqlString, const Args&...) throw (OSException);
+        
+        // Returns the result by columns: a tuple of one aligned vector per
+        // column, for analytic reads. See OSReduce for reductions on them.
+        template <typename... Columns, typename... Args>
+        std::tuple<OSColumn<Columns>...> executeColumns(const std::string& sqlString, const Args&...) throw (OSException);
         
         // Also we provide one interface executing SQL and return a scalar
         // value, e.g. select count(*). They will throw OSException if
         // got a failure.
         template <typename R, typename... Args>
-        R executeScalar(const std::string& sqlString, Args&...) throw(OSException);
+        R executeScalar(const std::string& sqlString, const Args&...) throw(OSException);
+        
+        // Execute sqlString once per tuple of parameters, with one prepared
+        // statement, e.g. executeMany("insert into Person values(?, ?)", rows)
+        // with rows a std::vector<std::tuple<int, std::string>>. With
+        // transaction, the rows are written in one savepoint (a transaction,
+        // or nested in the open one) and rolled back together on failure.
+        // Returns the rows written and the time taken.
+        template <typename... Args>
+        OSBatchTiming executeMany(const std::string& sqlString, const std::vector<std::tuple<Args...>>& rows, bool transaction = true) throw(OSException);
+        // The same over an input range of tuples.
+        template <typename InputIterator>
+        OSBatchTiming executeMany(const std::string& sqlString, InputIterator first, InputIterator last, bool transaction = true) throw(OSException);
         
         // Interfaces for transactions
         inline void begin() throw(OSException);
@@ -179,6 +626,465 @@ namespace OSQLite {
         inline void rollback() throw(OSException);
     };
     
+    /*
+     *  OSBlobHandle, incremental I/O on one blob value (sqlite3_blob_open),
+     *  found by table, column and rowid, so that a large blob is read or
+     *  written in chunks of the caller's buffer and never loaded whole.
+     *  Use OSBlobReader or OSBlobWriter. reopen() moves to another row of the
+     *  same column without a new handle. A blob cannot grow: write into the
+     *  space of zeroblob(n) or OSZeroBlob. If the row is changed by any other
+     *  statement, the handle expires and read or write throws SQLITE_ABORT.
+     *  Destroy the handle before its OSDatabase.
+     */
+    class OSBlobHandle {
+    protected:
+        sqlite3_blob* _blob = nullptr;
+        size_t _size = 0;
+        size_t _position = 0;
+        
+        OSBlobHandle(const OSDatabase& database, const std::string& table, const std::string& column, sqlite3_int64 rowid, const std::string& schema, bool write) throw(OSException);
+        
+    public:
+        OSBlobHandle(const OSBlobHandle&) = delete;
+        OSBlobHandle operator=(const OSBlobHandle&) = delete;
+        virtual ~OSBlobHandle();
+        
+        // Bytes of the blob, position of the next read or write, bytes after it.
+        inline size_t size() const noexcept;
+        inline size_t position() const noexcept;
+        inline size_t remaining() const noexcept;
+        inline void seek(size_t position) throw(OSException);
+        // The same column of another row, from position 0.
+        inline void reopen(sqlite3_int64 rowid) throw(OSException);
+    };
+    
+    /*
+     *  OSBlobReader, reads a blob in chunks, e.g.
+     *      OSBlobReader reader(database, "File", "content", rowid);
+     *      while (size_t n = reader.read(buffer, sizeof(buffer))) {...}
+     */
+    class OSBlobReader : public OSBlobHandle {
+    public:
+        OSBlobReader(const OSDatabase& database, const std::string& table, const std::string& column, sqlite3_int64 rowid, const std::string& schema = "main") throw(OSException);
+        
+        // Read up to size bytes into buffer and advance. Returns the bytes
+        // read, 0 at the end of the blob.
+        inline size_t read(void* buffer, size_t size) throw(OSException);
+    };
+    
+    /*
+     *  OSBlobWriter, writes a blob in chunks from position 0 onwards, e.g.
+     *      statement.execute("insert into File(id, content) values(?, ?)", id, zeroBlob);
+     *      OSBlobWriter writer(database, "File", "content", id);
+     *      writer.write(chunk, chunkSize);
+     *  Writing past size() throws.
+     */
+    class OSBlobWriter : public OSBlobHandle {
+    public:
+        OSBlobWriter(const OSDatabase& database, const std::string& table, const std::string& column, sqlite3_int64 rowid, const std::string& schema = "main") throw(OSException);
+        
+        // Write size bytes of data and advance.
+        inline void write(const void* data, size_t size) throw(OSException);
+        inline void write(const OSBlobView& data) throw(OSException);
+    };
+    
+    /*
+     *  OSLatencyHistogram, counts latencies in log-linear buckets of
+     *  nanoseconds (4 per power of two, so percentiles are within 25%).
+     *  Counters are relaxed atomics: recording takes no lock and may run
+     *  while another thread reads.
+     */
+    class OSLatencyHistogram {
+        static const size_t _bucketCount = 256;
+        std::atomic<unsigned long long> _buckets[_bucketCount];
+        std::atomic<unsigned long long> _count;
+        std::atomic<unsigned long long> _total;
+        
+        static inline size_t bucket(unsigned long long nanoseconds) noexcept;
+        static inline unsigned long long upperBound(size_t bucket) noexcept;
+        
+    public:
+        OSLatencyHistogram() noexcept;
+        OSLatencyHistogram(const OSLatencyHistogram&) = delete;
+        OSLatencyHistogram operator=(const OSLatencyHistogram&) = delete;
+        
+        inline void record(std::chrono::nanoseconds latency) noexcept;
+        inline void reset() noexcept;
+        inline unsigned long long count() const noexcept;
+        inline std::chrono::nanoseconds mean() const noexcept;
+        // Upper bound of the bucket holding the quantile, e.g. 0.99 for p99.
+        inline std::chrono::nanoseconds percentile(double quantile) const noexcept;
+    };
+    
+    /*
+     *  OSStatementMetrics, the counters of one SQL fingerprint: the SQL with
+     *  literals replaced by '?' and whitespace collapsed. Step counters come
+     *  from sqlite3_stmt_status, latency is from acquiring the statement to
+     *  releasing it (binding, stepping and reading the rows). A batch of
+     *  OSStatement::executeMany or OSQuery::executeAll holds the statement
+     *  for all its rows, so it counts as one execution with the latency of
+     *  the whole batch; rows counts the rows returned, not those written.
+     */
+    struct OSStatementMetrics {
+        std::string fingerprint;
+        unsigned long long executions = 0;
+        unsigned long long prepares = 0;
+        unsigned long long rows = 0;
+        unsigned long long vmSteps = 0;
+        unsigned long long fullScanSteps = 0;
+        unsigned long long sorts = 0;
+        unsigned long long autoIndexes = 0;
+        std::chrono::nanoseconds mean = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds p50 = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds p99 = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds p999 = std::chrono::nanoseconds(0);
+    };
+    
+    /*
+     *  OSMetricsSnapshot, returned by OSDatabase::metrics(). Per fingerprint
+     *  counters, all statements together in total, and the connection status
+     *  from sqlite3_db_status (page cache and memory used, in bytes).
+     */
+    struct OSMetricsSnapshot {
+        std::vector<OSStatementMetrics> statements;
+        OSStatementMetrics total;
+        unsigned long long statementCacheHits = 0;
+        unsigned long long statementCacheMisses = 0;
+        int pageCacheHits = 0;
+        int pageCacheMisses = 0;
+        int pageCacheWrites = 0;
+        int pageCacheMemory = 0;
+        int schemaMemory = 0;
+        int statementMemory = 0;
+        int lookasideUsed = 0;
+    };
+    
+    /*
+     *  OSMetrics, the recorder behind OSDatabase::enableMetrics. It is fed by
+     *  OSStatementCache, which every OSStatement, OSQuery and OSCursor path
+     *  goes through. Like the cache it is used by one thread at a time, but
+     *  snapshot() may run on any thread: the counters are atomics and the
+     *  lock is only taken when a new fingerprint shows up.
+     */
+    class OSMetrics {
+        friend class OSStatementCache;
+        
+        struct Counters {
+            std::atomic<unsigned long long> executions, prepares, rows, vmSteps, fullScanSteps, sorts, autoIndexes;
+            OSLatencyHistogram latency;
+            Counters() noexcept : executions(0), prepares(0), rows(0), vmSteps(0), fullScanSteps(0), sorts(0), autoIndexes(0) {}
+        };
+        struct Checkout {
+            sqlite3_stmt* statement;
+            Counters* counters;
+            std::chrono::steady_clock::time_point start;
+        };
+        
+        mutable std::mutex _mutex;
+        std::unordered_map<std::string, std::unique_ptr<Counters>> _fingerprints;
+        // Statements checked out of the cache, usually one or two.
+        std::vector<Checkout> _checkouts;
+        Counters _total;
+        
+        inline Checkout* find(sqlite3_stmt* statement) noexcept;
+        static inline void fill(OSStatementMetrics& metrics, const Counters& counters);
+        
+    public:
+        OSMetrics();
+        OSMetrics(const OSMetrics&) = delete;
+        OSMetrics operator=(const OSMetrics&) = delete;
+        
+        static inline std::string fingerprint(const std::string& sqlString);
+        
+        // counters keeps the Counters of the SQL from one execution to the
+        // next, e.g. in the cache entry of the statement; if null the SQL is
+        // fingerprinted and it is set.
+        inline void checkout(const std::string& sqlString, sqlite3_stmt* statement, bool prepared, Counters*& counters);
+        inline void row(sqlite3_stmt* statement) noexcept;
+        // Record the execution, returns its Counters. A batch of executeMany
+        // or executeAll is one execution, with the latency of the batch.
+        inline Counters* checkin(sqlite3_stmt* statement) noexcept;
+        inline void snapshot(OSMetricsSnapshot& snapshot) const;
+    };
+    
+    /*
+     *  OSSlowQuery, one entry of the slow-query log: the SQL, the SQL with
+     *  the bound parameters filled in, how long it took, and its EXPLAIN
+     *  QUERY PLAN. fullScan is set if a table is scanned without an index,
+     *  tempBTree if a temporary b-tree is built (ORDER BY, GROUP BY, DISTINCT
+     *  without a fitting index).
+     */
+    struct OSSlowQuery {
+        std::string sqlString;
+        std::string expandedSQL;
+        std::chrono::nanoseconds elapsed = std::chrono::nanoseconds(0);
+        std::vector<std::string> queryPlan;
+        bool fullScan = false;
+        bool tempBTree = false;
+    };
+    
+    /*
+     *  OSSlowQueryLog, the recorder behind OSDatabase::enableSlowQueryLog.
+     *  Like OSMetrics it is fed by OSStatementCache. Bound parameters are
+     *  taken from the sqlite3_trace text, which SQLite expands on the first
+     *  step of every statement; that is the cost of keeping the log on.
+     *  The newest capacity entries are kept. Scripts of several statements,
+     *  run by sqlite3_exec, are not logged.
+     */
+    class OSSlowQueryLog {
+        struct Checkout {
+            sqlite3_stmt* statement;
+            std::chrono::steady_clock::time_point start;
+            std::string expandedSQL;
+        };
+        
+        sqlite3* _connection;
+        std::chrono::nanoseconds _threshold;
+        size_t _capacity;
+        std::function<void(const OSSlowQuery&)> _callback;
+        
+        std::vector<Checkout> _checkouts;
+        // The statement in sqlite3_step, the target of the trace callback.
+        Checkout* _stepping = nullptr;
+        
+        mutable std::mutex _mutex;
+        std::deque<OSSlowQuery> _entries;
+        
+        static inline void trace(void* log, const char* expandedSQL);
+        inline Checkout* find(sqlite3_stmt* statement) noexcept;
+        inline void explain(OSSlowQuery& entry) noexcept;
+        
+    public:
+        OSSlowQueryLog(sqlite3* connection, std::chrono::nanoseconds threshold, size_t capacity, std::function<void(const OSSlowQuery&)> callback);
+        OSSlowQueryLog(const OSSlowQueryLog&) = delete;
+        OSSlowQueryLog operator=(const OSSlowQueryLog&) = delete;
+        ~OSSlowQueryLog();
+        
+        inline void checkout(sqlite3_stmt* statement);
+        inline void stepping(sqlite3_stmt* statement) noexcept;
+        inline void checkin(const std::string& sqlString, sqlite3_stmt* statement) noexcept;
+        inline std::vector<OSSlowQuery> entries() const;
+        inline void clear() noexcept;
+    };
+    
+    /*
+     *  OSStatementCache, a LRU cache of prepared sqlite3_stmt handles keyed by
+     *  SQL text. Each OSDatabase owns one. A statement is taken out of the cache
+     *  by acquire() and put back by release(), which resets it and clears its
+     *  bindings, so the same SQL is parsed and planned only once per connection.
+     *  Statements being used are not in the cache, so they are never evicted.
+     *  Thread-safe, as the connection is: OSStatements of one OSDatabase may
+     *  run on several threads.
+     */
+    class OSStatementCache {
+        struct _Entry {
+            std::string sqlString;
+            sqlite3_stmt* statement;
+            bool checkedOut;
+            // Null until the statement runs with metrics on.
+            OSMetrics::Counters* counters;
+        };
+        
+        sqlite3* const& _connection;
+        
+        // Guards the entries, the counters and the checkouts of metrics and
+        // the slow-query log. Recursive: a statement may run inside a step,
+        // e.g. from a user function.
+        mutable std::recursive_mutex _mutex;
+        
+        // Idle entries, most recently used at the front. A hit splices its
+        // entry to _checkedOut and release() splices it back, so that the
+        // steady state does not allocate.
+        std::list<_Entry> _entries;
+        std::list<_Entry> _checkedOut;
+        std::unordered_map<std::string, std::list<_Entry>::iterator> _index;
+        size_t _capacity;
+        unsigned long long _hits = 0;
+        unsigned long long _misses = 0;
+        
+        // Null unless enabled, so they cost one branch when not.
+        std::unique_ptr<OSMetrics> _metrics;
+        std::unique_ptr<OSSlowQueryLog> _slowQueryLog;
+        
+        inline void evict(size_t size);
+        inline void erase(std::list<_Entry>& list, std::list<_Entry>::iterator entry);
+        
+    public:
+        OSStatementCache(sqlite3* const& connection, size_t capacity);
+        OSStatementCache(const OSStatementCache&) = delete;
+        OSStatementCache operator=(const OSStatementCache&) = delete;
+        ~OSStatementCache();
+        
+        // Get a prepared statement for the SQL, reusing a cached one if any.
+        // Returns the SQLite result code of the preparation. With single, SQL
+        // that is not exactly one statement (a script, or only comments) is
+        // not prepared: statement is null and the result SQLITE_OK.
+        inline int acquire(const std::string& sqlString, sqlite3_stmt** statement, bool single = false) noexcept;
+        // Reset the statement and give it back. It is finalized instead if
+        // the cache is disabled or already holds another statement of the
+        // same SQL.
+        inline void release(const std::string& sqlString, sqlite3_stmt* statement) noexcept;
+        // sqlite3_step on an acquired statement, counting rows for metrics.
+        inline int step(sqlite3_stmt* statement) noexcept;
+        // Finalize all idle statements.
+        inline void clear() noexcept;
+        
+        // Start (from zero) or stop recording metrics. Only call it while no
+        // statement is checked out.
+        inline void enableMetrics(bool enable) noexcept;
+        inline const OSMetrics* metrics() const noexcept;
+        // The same for the slow-query log, null disables it.
+        inline void setSlowQueryLog(OSSlowQueryLog* slowQueryLog) noexcept;
+        inline const OSSlowQueryLog* slowQueryLog() const noexcept;
+        
+        // Capacity 0 disables caching. Shrinking evicts the least recently
+        // used. Capacity and size count idle statements only.
+        inline void setCapacity(size_t capacity) noexcept;
+        inline size_t capacity() const noexcept;
+        inline size_t size() const noexcept;
+        inline unsigned long long hits() const noexcept;
+        inline unsigned long long misses() const noexcept;
+    };
+    
+    /*
+     *  OSObjectRowOps, how OSObjectCache keeps the rows of one table type:
+     *  made once per type by OSTablePolicy, it copies the keys of an object
+     *  into a row and back, and gives the cache key of the primary key.
+     */
+    struct OSObjectRowOps {
+        void* (*create)(const char* object, const ptrdiff_t* offsets);
+        void (*assign)(char* object, const ptrdiff_t* offsets, const void* row);
+        void (*destroy)(void* row);
+        // Bytes of the row, with what its values allocate.
+        size_t (*bytes)(const void* row);
+        std::string (*key)(const char* object, const ptrdiff_t* offsets);
+    };
+    
+    /*
+     *  OSObjectCacheStatistics, counters of an OSObjectCache since enabled.
+     */
+    struct OSObjectCacheStatistics {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long evictions = 0;
+        // Entries dropped by writes and schema changes.
+        unsigned long long invalidations = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t memoryBudget = 0;
+        
+        inline double hitRate() const noexcept;
+    };
+    
+    /*
+     *  OSObjectCache, an LRU identity map of OSQuery::fill and exists, keyed
+     *  by table and primary key, within a memory budget. Each OSDatabase may
+     *  own one, see OSDatabase::enableObjectCache. Rows are only cached when
+     *  read outside a transaction, so a rollback cannot leave stale rows.
+     *  OSQuery writes drop their key; any other change of a row seen by the
+     *  update hook drops all the rows of its table, and so do rows changed by
+     *  triggers of an OSQuery write. A generation counter keeps a row read
+     *  before a change from being stored after it. Thread-safe.
+     */
+    class OSObjectCache {
+        struct _Entry {
+            std::string table;
+            std::string key;
+            const OSObjectRowOps* ops;
+            void* row;
+            size_t bytes;
+        };
+        
+        mutable std::mutex _mutex;
+        // Most recently used entry at the front.
+        std::list<_Entry> _entries;
+        std::unordered_map<std::string, std::unordered_map<std::string, std::list<_Entry>::iterator>> _tables;
+        OSObjectCacheStatistics _statistics;
+        unsigned long long _generation = 0;
+        
+        // The OSQuery write in progress: its thread, its table, and whether
+        // its own change of the table was seen.
+        std::thread::id _writer;
+        std::string _writerTable;
+        bool _writerChanged = false;
+        
+        inline std::list<_Entry>::iterator find(const std::string& table, const std::string& key, const OSObjectRowOps* ops) noexcept;
+        inline void erase(std::list<_Entry>::iterator entry) noexcept;
+        inline void eraseTable(const std::string& table) noexcept;
+        inline void evict() noexcept;
+        
+    public:
+        OSObjectCache(size_t memoryBudget);
+        OSObjectCache(const OSObjectCache&) = delete;
+        OSObjectCache operator=(const OSObjectCache&) = delete;
+        ~OSObjectCache();
+        
+        // Table names as the cache keeps them: SQLite names ignore case.
+        static inline std::string tableKey(const char* table);
+        
+        // Copy the cached row of the key into the object, or find whether
+        // the key is cached. Both count a hit or a miss.
+        inline bool lookup(const std::string& table, const std::string& key, const OSObjectRowOps* ops, char* object, const ptrdiff_t* offsets);
+        inline bool contains(const std::string& table, const std::string& key, const OSObjectRowOps* ops) noexcept;
+        // Take the generation before reading a row, and store the row with
+        // it: it is not stored if anything changed in between.
+        inline unsigned long long generation() const noexcept;
+        inline void store(const std::string& table, const std::string& key, const OSObjectRowOps* ops, const char* object, const ptrdiff_t* offsets, unsigned long long generation) noexcept;
+        
+        // Around an OSQuery write of one row, on the writing thread.
+        inline void beginWrite(const std::string& table) noexcept;
+        inline void endWrite(const std::string& table, const std::string& key) noexcept;
+        // A row of table changed (from the update hook), or the schema.
+        inline void changed(const char* table) noexcept;
+        inline void invalidate() noexcept;
+        
+        inline void setMemoryBudget(size_t memoryBudget) noexcept;
+        inline OSObjectCacheStatistics statistics() const noexcept;
+    };
+    
+    /*
+     *  OSDatabaseOptions, how an OSDatabase is opened and tuned. Fields left
+     *  at their "keep" value are not touched, the rest are set by pragmas.
+     *  openFlags is only used when opening, and pageSize only takes effect on
+     *  a new database (or after vacuum) not in WAL mode. Named profiles:
+     *      oltp()              WAL, synchronous=NORMAL, in-memory temp store.
+     *      bulkLoad()          journal in memory, synchronous=OFF, big cache.
+     *                          Not durable: a crash can corrupt the database.
+     *      readOnlyAnalytics() query_only, memory-mapped reads, big cache.
+     *      inMemoryMirror()    the whole database in memory, flushed to the
+     *                          file every flushInterval. Not durable between
+     *                          flushes.
+     */
+    struct OSDatabaseOptions {
+        int openFlags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+        // e.g. "WAL", "DELETE", "MEMORY", "OFF". Empty keeps it.
+        std::string journalMode;
+        // 0 OFF, 1 NORMAL, 2 FULL, 3 EXTRA. -1 keeps it.
+        int synchronous = -1;
+        // Pages if positive, KiB if negative. 0 keeps it.
+        long long cacheSize = 0;
+        // Bytes of the file read through mmap, 0 disables it. -1 keeps it.
+        long long mmapSize = -1;
+        // 0 DEFAULT, 1 FILE, 2 MEMORY. -1 keeps it.
+        int tempStore = -1;
+        // 0 keeps it.
+        int pageSize = 0;
+        // 1 refuses writes, 0 allows them. -1 keeps it.
+        int queryOnly = -1;
+        // Milliseconds to wait on a locked database. -1 keeps it.
+        int busyTimeout = -1;
+        // Mirror mode: the file is loaded into a ":memory:" connection when
+        // opened, statements never touch the file, and writes reach it by
+        // OSDatabase::flush(), every flushInterval (0 never) and when closed.
+        bool mirror = false;
+        std::chrono::milliseconds flushInterval = std::chrono::milliseconds(0);
+        
+        static inline OSDatabaseOptions oltp() noexcept;
+        static inline OSDatabaseOptions bulkLoad() noexcept;
+        static inline OSDatabaseOptions readOnlyAnalytics() noexcept;
+        static inline OSDatabaseOptions inMemoryMirror(std::chrono::milliseconds flushInterval = std::chrono::milliseconds(1000)) noexcept;
+    };
+    
     /*
      *  OSDatabase class, control the access to SQLite database.
      *  Follow the RAII principle, the database is opened and closed when you
@@ -187,15 +1093,543 @@ namespace OSQLite {
     class OSDatabase {
         friend class OSStatement;
         friend class OSQuery;
+        friend class OSDatabasePool;
+        friend class OSGroupCommitQueue;
+        friend class OSBlobHandle;
+        friend class OSBackup;
         
         // SQLite connection. NOTICE the exception safety.
         sqlite3* _connection = nullptr;
         
+        // Prepared statements of this connection. Declared after _connection
+        // and cleared before it is closed.
+        mutable OSStatementCache _statementCache;
+        
+        // The file behind _connection in mirror mode, else null.
+        std::unique_ptr<OSMirror> _mirror;
+        
+        // Listeners of the update hook, installed with the first of them.
+        std::mutex _updateMutex;
+        std::vector<std::pair<size_t, std::function<void(int, const char*, const char*, sqlite3_int64)>>> _updateListeners;
+        size_t _lastUpdateListener = 0;
+        // Null unless enabled. It is an update listener, and the authorizer
+        // tells it of schema changes.
+        std::unique_ptr<OSObjectCache> _objectCache;
+        size_t _objectCacheListener = 0;
+        // Name of the table a DROP is authorized for. SQLite checks
+        // SQLITE_DELETE on it right after, which must not be ignored.
+        const char* _droppedTable = nullptr;
+        
+        static inline void updateHook(void* database, int operation, const char* databaseName, const char* table, sqlite3_int64 rowid) noexcept;
+        static inline int authorize(void* database, int action, const char* argument1, const char* argument2, const char* databaseName, const char* trigger) noexcept;
+        
     public:
         OSDatabase(const std::string& dbName) throw(OSException);
+        // Open with sqlite3_open_v2 flags, e.g. SQLITE_OPEN_READONLY.
+        OSDatabase(const std::string& dbName, int openFlags) throw(OSException);
+        OSDatabase(const std::string& dbName, const OSDatabaseOptions& options) throw(OSException);
         OSDatabase(const OSDatabase&) = delete;
         OSDatabase operator=(const OSDatabase&&) = delete;
         virtual ~OSDatabase();
+        
+        // The prepared statement cache used by OSStatement on this connection.
+        inline OSStatementCache& statementCache() const noexcept;
+        
+        // Rowid of the last insert on this connection, e.g. for OSBlobWriter.
+        inline sqlite3_int64 lastInsertRowid() const noexcept;
+        
+        // Apply the tuning of options (or a profile) to the open connection,
+        // e.g. applyOptions(OSDatabaseOptions::bulkLoad()).
+        inline void applyOptions(const OSDatabaseOptions& options) throw(OSException);
+        
+        // Statement metrics, off by default. Enabling starts from zero.
+        inline void enableMetrics(bool enable = true) noexcept;
+        inline bool metricsEnabled() const noexcept;
+        // Counters so far, also from another thread. The sqlite3_db_status
+        // part is filled in even when metrics are disabled.
+        inline OSMetricsSnapshot metrics() const;
+        
+        // Log the statements taking at least threshold, with their bound
+        // parameters and query plan, e.g. to find missing indexes. callback,
+        // if any, is called with each entry on the executing thread.
+        inline void enableSlowQueryLog(std::chrono::microseconds threshold, size_t capacity = 128, std::function<void(const OSSlowQuery&)> callback = nullptr);
+        inline void disableSlowQueryLog() noexcept;
+        // Entries so far, oldest first, also from another thread.
+        inline std::vector<OSSlowQuery> slowQueries() const;
+        
+        // Online backup of this database to filePath, on a background thread:
+        // pagesPerStep pages (-1 for all) are copied at a time, with a pause
+        // of sleep between steps so that writers are not stalled. progress is
+        // called after each step on the backup thread.
+        inline std::unique_ptr<OSBackup> backupTo(const std::string& filePath, int pagesPerStep = 100, std::chrono::milliseconds sleep = std::chrono::milliseconds(10), std::function<void(const OSBackupProgress&)> progress = nullptr) throw(OSException);
+        // The reverse: replace this database with the content of filePath,
+        // e.g. to load a file into a ":memory:" database. Do not use this
+        // connection until the OSBackup is done.
+        inline std::unique_ptr<OSBackup> restoreFrom(const std::string& filePath, int pagesPerStep = 100, std::chrono::milliseconds sleep = std::chrono::milliseconds(10), std::function<void(const OSBackupProgress&)> progress = nullptr) throw(OSException);
+        
+        // Mirror mode: write the changes in memory to the file now. Does
+        // nothing when nothing changed, or without mirror mode.
+        inline void flush() throw(OSException);
+        inline bool isMirror() const noexcept;
+        
+        // Listen to the rows changed through this connection (update hook):
+        // operation is SQLITE_INSERT, SQLITE_UPDATE or SQLITE_DELETE. Called
+        // on the writing thread during the step; a listener must not use the
+        // connection, nor add or remove listeners, nor throw. Returns the
+        // listener id.
+        inline size_t addUpdateListener(std::function<void(int operation, const char* databaseName, const char* table, sqlite3_int64 rowid)> listener);
+        inline void removeUpdateListener(size_t id) noexcept;
+        
+        // Identity map of OSQuery::fill and exists, see OSObjectCache. While
+        // enabled, "delete from" a table without where deletes row by row, so
+        // that the update hook sees it. Writes by other connections are not
+        // seen: use it when this connection is the only writer (e.g. in
+        // mirror mode), or call invalidateObjectCache(). Enable and disable
+        // it while no other thread uses the connection.
+        inline void enableObjectCache(size_t memoryBudget = 4194304);
+        inline void disableObjectCache() noexcept;
+        inline void invalidateObjectCache() noexcept;
+        inline OSObjectCacheStatistics objectCacheStatistics() const noexcept;
+    };
+    
+    /*
+     *  OSBackupProgress, pages of an OSBackup still to copy, out of pageCount.
+     *  Both are 0 before the first step.
+     */
+    struct OSBackupProgress {
+        int remaining = 0;
+        int pageCount = 0;
+        
+        // From 0 to 1.
+        inline double fraction() const noexcept;
+    };
+    
+    /*
+     *  OSBackup, a running backup or restore (sqlite3_backup), made by
+     *  OSDatabase::backupTo or restoreFrom. The source keeps being read and
+     *  written meanwhile: a change through the same connection is copied to
+     *  the destination as well, a change through another connection restarts
+     *  the backup at the next step. A busy or locked step is retried after
+     *  the pause. The destination is not changed unless the backup completes.
+     *  The connection must allow use from another thread (the default open
+     *  flags, not SQLITE_OPEN_NOMUTEX), and the OSBackup must be destroyed
+     *  before its OSDatabase. Destroying it cancels the backup.
+     */
+    class OSBackup {
+        friend class OSDatabase;
+        
+        // The connection to filePath, owned by the backup.
+        sqlite3* _file = nullptr;
+        sqlite3_backup* _backup = nullptr;
+        const int _pagesPerStep;
+        const std::chrono::milliseconds _sleep;
+        std::function<void(const OSBackupProgress&)> _progress;
+        
+        std::thread _thread;
+        std::mutex _mutex;
+        std::condition_variable _cancel;
+        bool _cancelled = false;
+        std::atomic<bool> _finished;
+        std::atomic<int> _remaining;
+        std::atomic<int> _pageCount;
+        // Set by the backup thread before _finished.
+        int _result = SQLITE_OK;
+        bool _completed = false;
+        
+        OSBackup(OSDatabase& database, const std::string& filePath, bool restore, int pagesPerStep, std::chrono::milliseconds sleep, std::function<void(const OSBackupProgress&)> progress) throw(OSException);
+        inline void run() noexcept;
+        
+    public:
+        OSBackup(const OSBackup&) = delete;
+        OSBackup operator=(const OSBackup&) = delete;
+        virtual ~OSBackup();
+        
+        // Wait for the end of the backup. Returns false if it was cancelled,
+        // throws if it failed.
+        inline bool wait() throw(OSException);
+        // Stop at the next step, the destination is left as it was.
+        inline void cancel() noexcept;
+        inline bool finished() const noexcept;
+        inline OSBackupProgress progress() const noexcept;
+    };
+    
+    /*
+     *  OSMirror, the file behind an OSDatabase in mirror mode. It loads the
+     *  file into the in-memory connection with one sequential read, then
+     *  copies the whole database back (sqlite3_backup, in one step, since any
+     *  commit in memory would restart a stepwise copy) on flush() and from
+     *  its thread every flushInterval, if a transaction was committed since.
+     *  A flush is one transaction on the file, so the file always holds a
+     *  consistent state. The file is not written if opened read-only. A
+     *  failed periodic flush is retried at the next interval; the last flush
+     *  is made when the OSDatabase is destroyed, call flush() before to see
+     *  its error.
+     */
+    class OSMirror {
+        sqlite3* _memory;
+        sqlite3* _file = nullptr;
+        const std::chrono::milliseconds _flushInterval;
+        const bool _readOnly;
+        
+        // Commits in memory, counted by the commit hook, and those flushed.
+        std::atomic<unsigned long long> _commits;
+        unsigned long long _flushedCommits = 0;
+        std::mutex _flushMutex;
+        
+        std::thread _flusher;
+        std::mutex _mutex;
+        std::condition_variable _stop;
+        bool _stopped = false;
+        
+        static inline int copy(sqlite3* destination, sqlite3* source) noexcept;
+        static inline int commit(void* mirror) noexcept;
+        inline void run() noexcept;
+        
+    public:
+        OSMirror(sqlite3* memory, const std::string& filePath, int openFlags, std::chrono::milliseconds flushInterval) throw(OSException);
+        OSMirror(const OSMirror&) = delete;
+        OSMirror operator=(const OSMirror&) = delete;
+        virtual ~OSMirror();
+        
+        inline void flush() throw(OSException);
+    };
+    
+    /*
+     *  OSPooledDatabase, a connection checked out of an OSDatabasePool. It
+     *  gives the connection back when destroyed. Use it as an OSDatabase:
+     *  e.g. OSStatement statement(*pooledDatabase);
+     */
+    class OSPooledDatabase {
+        friend class OSDatabasePool;
+        
+        OSDatabasePool* _pool;
+        OSDatabase* _database;
+        bool _writer;
+        
+        OSPooledDatabase(OSDatabasePool& pool, OSDatabase& database, bool writer) noexcept;
+        
+    public:
+        OSPooledDatabase(OSPooledDatabase&& other) noexcept;
+        OSPooledDatabase(const OSPooledDatabase&) = delete;
+        OSPooledDatabase operator=(const OSPooledDatabase&) = delete;
+        ~OSPooledDatabase();
+        
+        inline OSDatabase& operator*() const noexcept;
+        inline OSDatabase* operator->() const noexcept;
+        // Whether this is the writer connection.
+        inline bool isWriter() const noexcept;
+    };
+    
+    /*
+     *  OSDatabasePool, a thread-safe pool of connections to one database file:
+     *  one writer and readerCount read-only readers, in WAL mode so that the
+     *  readers never wait for the writer. Threads check connections out with
+     *  reader(), writer() or acquire(sql), which sends read-only SQL to a
+     *  reader and everything else to the writer. They wait while all
+     *  connections of the kind are checked out. Each connection is used by
+     *  one thread at a time, so they are opened with SQLITE_OPEN_NOMUTEX.
+     *  The pool must outlive the connections checked out of it.
+     */
+    class OSDatabasePool {
+        friend class OSPooledDatabase;
+        
+        std::unique_ptr<OSDatabase> _writer;
+        std::vector<std::unique_ptr<OSDatabase>> _readers;
+        
+        std::mutex _mutex;
+        std::condition_variable _released;
+        bool _writerIdle = true;
+        std::vector<OSDatabase*> _idleReaders;
+        // Whether a SQL is read-only, decided once by sqlite3_stmt_readonly.
+        std::unordered_map<std::string, bool> _readOnlySQL;
+        
+        inline void release(OSDatabase* database, bool writer) noexcept;
+        
+    public:
+        OSDatabasePool(const std::string& dbName, size_t readerCount) throw(OSException);
+        OSDatabasePool(const OSDatabasePool&) = delete;
+        OSDatabasePool operator=(const OSDatabasePool&) = delete;
+        virtual ~OSDatabasePool();
+        
+        inline OSPooledDatabase reader() throw(OSException);
+        inline OSPooledDatabase writer() throw(OSException);
+        inline OSPooledDatabase acquire(const std::string& sqlString) throw(OSException);
+        inline size_t readerCount() const noexcept;
+    };
+    
+    /*
+     *  OSAsyncDatabase, runs the work on its own connection in a worker
+     *  thread, so the caller does not wait on disk I/O. Every call returns a
+     *  std::future (or takes a callback) and work runs in the order it was
+     *  submitted. At most queueCapacity submissions wait in the queue, a
+     *  submit beyond that blocks until there is room.
+     *  SQL arguments are copied into the submission. OSQuery objects are
+     *  taken by reference: keep them alive until the future is ready.
+     *  The destructor finishes all submitted work.
+     */
+    class OSAsyncDatabase {
+        
+        OSDatabase _database;
+        
+        size_t _queueCapacity;
+        std::deque<std::function<void()>> _queue;
+        std::mutex _mutex;
+        std::condition_variable _notEmpty;
+        std::condition_variable _notFull;
+        bool _stopped = false;
+        
+        // Declared last, started once the rest is ready.
+        std::thread _worker;
+        
+        inline void enqueue(std::function<void()> work) throw(OSException);
+        inline void run() noexcept;
+        
+    public:
+        OSAsyncDatabase(const std::string& dbName, const OSDatabaseOptions& options = OSDatabaseOptions(), size_t queueCapacity = 1024) throw(OSException);
+        OSAsyncDatabase(const OSAsyncDatabase&) = delete;
+        OSAsyncDatabase operator=(const OSAsyncDatabase&) = delete;
+        virtual ~OSAsyncDatabase();
+        
+        // Run task(OSDatabase&) on the worker thread. Its result or exception
+        // goes to the future, or to callback(std::future) called on the worker.
+        template <typename Task>
+        std::future<typename std::result_of<Task(OSDatabase&)>::type> submit(Task task) throw(OSException);
+        template <typename Task, typename Callback>
+        void submit(Task task, Callback callback) throw(OSException);
+        
+        // The same as OSStatement.
+        template <typename... Args>
+        std::future<void> execute(const std::string& sqlString, const Args&... args) throw(OSException);
+        template <typename... Returns, typename... Args>
+        std::future<std::vector<std::tuple<Returns...>>> executeRows(const std::string& sqlString, const Args&... args) throw(OSException);
+        template <typename R, typename... Args>
+        std::future<R> executeScalar(const std::string& sqlString, const Args&... args) throw(OSException);
+        
+        // The same as OSQuery.
+        template <typename Table> std::future<void> save(Table& table) throw(OSException);
+        template <typename Table> std::future<bool> exists(Table& table) throw(OSException);
+        template <typename Table> std::future<bool> fill(Table& table) throw(OSException);
+        template <typename Table> std::future<void> update(Table& table) throw(OSException);
+        template <typename Table> std::future<bool> saveOrUpdate(Table& table) throw(OSException);
+        template <typename Table> std::future<void> deleteObject(Table& table) throw(OSException);
+        
+        // Submissions waiting in the queue.
+        inline size_t pending() noexcept;
+        inline size_t queueCapacity() const noexcept;
+    };
+    
+    /*
+     *  OSGroupCommitQueue, coalesces the writes of many threads into few
+     *  transactions. Threads submit write operations into a lock-free queue
+     *  (multiple producers, one consumer), and one writer thread runs them
+     *  in batches: a batch is one transaction holding up to maxBatch
+     *  operations, or those submitted within window after its first one.
+     *  The future of an operation is ready when its batch is committed.
+     *  Each operation runs in a savepoint, so a failed one gets its
+     *  exception and does not undo the others in the batch, unless SQLite
+     *  rolls the whole transaction back (e.g. OR ROLLBACK, SQLITE_FULL):
+     *  then the operations before it in the batch fail too.
+     */
+    class OSGroupCommitQueue {
+        
+        struct Operation {
+            std::function<void(OSDatabase&)> write;
+            std::promise<void> committed;
+        };
+        // Intrusive node of the queue (Vyukov's MPSC queue). The last popped
+        // node stays in the queue as its stub, so operations are moved out.
+        struct Node {
+            std::atomic<Node*> next;
+            Operation operation;
+            Node() : next(nullptr) {}
+        };
+        
+        OSDatabase _database;
+        size_t _maxBatch;
+        std::chrono::microseconds _window;
+        
+        // Producers exchange _head, only the writer reads from _tail.
+        std::atomic<Node*> _head;
+        Node* _tail;
+        
+        std::atomic<bool> _stopped;
+        std::atomic<bool> _sleeping;
+        std::mutex _mutex;
+        std::condition_variable _wakeUp;
+        
+        std::atomic<unsigned long long> _batches;
+        std::atomic<unsigned long long> _operations;
+        
+        // Declared last, started once the rest is ready.
+        std::thread _writer;
+        
+        inline void push(Node* node) noexcept;
+        inline bool pop(Operation& operation) noexcept;
+        inline bool wait(std::chrono::steady_clock::time_point deadline) noexcept;
+        // Returns false if the transaction of the batch is gone.
+        inline bool executeOne(Operation& operation, std::vector<Operation>& batch) noexcept;
+        inline void run() noexcept;
+        
+    public:
+        OSGroupCommitQueue(const std::string& dbName, size_t maxBatch = 256, std::chrono::microseconds window = std::chrono::microseconds(2000), const OSDatabaseOptions& options = OSDatabaseOptions::oltp()) throw(OSException);
+        OSGroupCommitQueue(const OSGroupCommitQueue&) = delete;
+        OSGroupCommitQueue operator=(const OSGroupCommitQueue&) = delete;
+        virtual ~OSGroupCommitQueue();
+        
+        // Queue write(OSDatabase&), e.g. a lambda using OSStatement or OSQuery.
+        inline std::future<void> submit(std::function<void(OSDatabase&)> write) throw(OSException);
+        // Queue one SQL, the arguments are copied.
+        template <typename... Args>
+        std::future<void> execute(const std::string& sqlString, const Args&... args) throw(OSException);
+        
+        // Committed batches and operations so far.
+        inline unsigned long long batches() const noexcept;
+        inline unsigned long long operations() const noexcept;
+    };
+    
+    /*
+     *  OSMappedFile, a whole file mapped read-only into memory (mmap, or
+     *  MapViewOfFile on Windows), unmapped when destroyed. An empty file
+     *  gives data() nullptr and size() 0.
+     */
+    class OSMappedFile {
+        const char* _data = nullptr;
+        size_t _size = 0;
+#ifdef _MSC_VER
+        HANDLE _file = INVALID_HANDLE_VALUE;
+        HANDLE _mapping = nullptr;
+#endif
+        
+    public:
+        OSMappedFile(const std::string& filePath) throw(OSException);
+        OSMappedFile(const OSMappedFile&) = delete;
+        OSMappedFile operator=(const OSMappedFile&) = delete;
+        virtual ~OSMappedFile();
+        
+        inline const char* data() const noexcept;
+        inline size_t size() const noexcept;
+    };
+    
+    /*
+     *  OSFieldType, how OSBulkLoader parses a field before binding it. An
+     *  empty integer or real field is NULL, an empty text field is ''.
+     */
+    enum class OSFieldType {
+        text,
+        integer,
+        real
+    };
+    
+    /*
+     *  OSBulkLoadStatistics, the progress of OSBulkLoader::load.
+     */
+    struct OSBulkLoadStatistics {
+        size_t rows = 0;
+        size_t batches = 0;
+        size_t transactions = 0;
+        // Bytes of the file
+        size_t bytes = 0;
+        std::chrono::microseconds elapsed = std::chrono::microseconds(0);
+        
+        inline double rowsPerSecond() const noexcept;
+    };
+    
+    /*
+     *  OSBulkLoadOptions, the input format and the pipeline of OSBulkLoader.
+     *  Without fieldWidths the file is delimited (CSV): a field may be quoted,
+     *  with the quote doubled inside it. With fieldWidths it is fixed-width:
+     *  one record per line, spaces around each field are trimmed.
+     */
+    struct OSBulkLoadOptions {
+        char delimiter = ',';
+        // 0 if fields are never quoted.
+        char quote = '"';
+        // Skip the first line.
+        bool header = false;
+        // Width of each field of fixed-width records.
+        std::vector<size_t> fieldWidths;
+        // Rows parsed into one batch, handed to the writer at once.
+        size_t batchSize = 8192;
+        // Rows per transaction, 0 for one transaction for the whole file.
+        size_t transactionSize = 1000000;
+        // 0 uses one thread per core but one (the writer). With several
+        // threads rows are not inserted in file order, and a quote may only
+        // start or end a field: the file is split by the parity of quotes.
+        size_t parserThreads = 1;
+        // Batches parsed ahead of the writer.
+        size_t queueCapacity = 8;
+        // Apply OSDatabaseOptions::bulkLoad() while loading, then restore.
+        bool bulkPragmas = true;
+        // Called after each commit on the loading thread.
+        std::function<void(const OSBulkLoadStatistics&)> progress;
+    };
+    
+    /*
+     *  OSBulkLoader, imports a delimited or fixed-width file into a table.
+     *  The file is memory-mapped and split between the parser threads. They
+     *  scan 8 bytes at a time for delimiters (SWAR), parse numbers in place
+     *  and hand batches of rows through a bounded queue to the calling thread,
+     *  which writes them with one insert statement in large transactions.
+     *  Text is bound straight from the mapped file. e.g.
+     *      OSBulkLoader loader(database, "Person", {"id", "name", "address"},
+     *          {OSFieldType::integer, OSFieldType::text, OSFieldType::text});
+     *      OSBulkLoadStatistics statistics = loader.load("person.csv");
+     *  A bad record stops the load and rolls back its transaction, earlier
+     *  transactions are kept. The OSException tells the byte offset.
+     */
+    class OSBulkLoader {
+        
+        // A parsed field. text points into the mapped file, or into the
+        // unescaped strings of the batch.
+        struct Field {
+            const char* text;
+            size_t size;
+            union {
+                long long integer;
+                double real;
+            };
+            bool null;
+        };
+        struct Batch {
+            std::vector<Field> fields;
+            std::list<std::string> unescaped;
+            size_t rows = 0;
+        };
+        
+        OSDatabase& _database;
+        std::string _sqlString;
+        std::vector<OSFieldType> _types;
+        OSBulkLoadOptions _options;
+        
+        // The pipeline of one load.
+        std::mutex _mutex;
+        std::condition_variable _parsed;
+        std::condition_variable _consumed;
+        std::deque<std::unique_ptr<Batch>> _queue;
+        std::vector<std::unique_ptr<Batch>> _freeBatches;
+        size_t _runningParsers = 0;
+        bool _aborted = false;
+        std::exception_ptr _error;
+        
+        static inline const char* scan(const char* begin, const char* end, char delimiter) noexcept;
+        static inline bool parseInteger(const char* begin, const char* end, long long& value) noexcept;
+        static inline bool parseReal(const char* begin, const char* end, double& value) noexcept;
+        inline void parseField(const char* begin, const char* end, size_t column, Field& field, size_t offset) const throw(OSException);
+        inline const char* parseDelimited(const char* begin, const char* end, const char* fileBegin, Batch& batch) const throw(OSException);
+        inline const char* parseFixedWidth(const char* begin, const char* end, const char* fileBegin, Batch& batch) const throw(OSException);
+        inline bool push(std::unique_ptr<Batch>& batch) noexcept;
+        inline void parse(const char* begin, const char* end, const char* fileBegin, const char* fileEnd) noexcept;
+        inline std::unique_ptr<Batch> nextBatch() noexcept;
+        inline void write(OSBulkLoadStatistics& statistics, std::chrono::steady_clock::time_point start) throw(OSException);
+        
+    public:
+        OSBulkLoader(OSDatabase& database, const std::string& table, const std::vector<std::string>& columns, const std::vector<OSFieldType>& types, const OSBulkLoadOptions& options = OSBulkLoadOptions()) throw(OSException);
+        OSBulkLoader(const OSBulkLoader&) = delete;
+        OSBulkLoader operator=(const OSBulkLoader&) = delete;
+        virtual ~OSBulkLoader();
+        
+        // Import the file, returns the rows written and rowsPerSecond().
+        inline OSBulkLoadStatistics load(const std::string& filePath) throw(OSException);
     };
     
 }
@@ -11,566 +11,1057 @@
 
 namespace OSQLite {
     
-    // Define a templated struct named OSTypeOp (inherited from OSPlaceholder), used
-    // to encapsulate type bindings from database to clients, or vice versa. (at compile-time)
-    //
-    // Funtions:
-    //      ctors: used for OSTablePolicy class.
-    //      statementReturnAssign: extract data from database to the tuple
-    //      statementParamBinding: bind parameters to sql - for OSStatement operations
-    //      queryReturnAssign: OSQuery operations extracting data
-    //      queryParamBinding: OSQuery operations bind params
-    //      queryPrimaryKey: OSQuery operations insert primary key to sql string
-    //
-    // All functions may throw OSException.
-    // Providing types including: int, unsigned int, long, unsigned long, std::string
-	struct OSPlaceHolder {
-        OSPlaceHolder(){}
-        virtual ~OSPlaceHolder(){}
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) = 0;
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) = 0;
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) = 0;
-    };
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp : virtual public OSPlaceHolder {
-        
-        OSTypeOp(Args&... args_){ throw OSException("Unregisted type. Please check first."); }
-		virtual ~OSTypeOp(){}
-
-        // If this function called, throw an error
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            throw OSException("OSTypeOp error: statementReturnAssign: invalid type.");
-        }
-        // If this function called, throw an error
-        static inline void statementParamBinding(sqlite3_stmt* statement_, Args&...) {
-            throw OSException("OSTypeOp error: statementParamBinding: invalid type.");
-        }
-        // If this function called, throw an error
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            throw OSException("OSTypeOp error: queryReturnAssign: invalid type.");
-        }
-        // If this function called, throw an error
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            throw OSException("OSTypeOp error: queryParamBinding: invalid type.");
+    // Column extraction and parameter binding of a single value, overloaded
+    // by type. Text is copied once, straight from SQLite's buffer, and NULL
+    // text gives an empty string.
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, int& value_)
+    {value_ = sqlite3_column_int(statement_, column_);}
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, unsigned int& value_)
+    {value_ = (unsigned int)sqlite3_column_int(statement_, column_);}
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, long& value_)
+    {value_ = (long)sqlite3_column_int64(statement_, column_);}
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, unsigned long& value_)
+    {value_ = (unsigned long)sqlite3_column_int64(statement_, column_);}
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, float& value_)
+    {value_ = (float)sqlite3_column_double(statement_, column_);}
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, double& value_)
+    {value_ = sqlite3_column_double(statement_, column_);}
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, std::string& value_)
+    {
+        const char* _text = (const char*)sqlite3_column_text(statement_, column_);
+        if (_text == nullptr) {
+            value_.clear();
+        } else {
+            value_.assign(_text, sqlite3_column_bytes(statement_, column_));
         }
-        // If this function called, throw an error
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            throw OSException("OSTypeOp error: queryPrimaryKey: invalid type.");
+    }
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, OSTextView& value_)
+    {
+        value_.data = (const char*)sqlite3_column_text(statement_, column_);
+        value_.size = value_.data == nullptr ? 0 : sqlite3_column_bytes(statement_, column_);
+    }
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, OSBlobView& value_)
+    {
+        value_.data = (const unsigned char*)sqlite3_column_blob(statement_, column_);
+        value_.size = value_.data == nullptr ? 0 : sqlite3_column_bytes(statement_, column_);
+    }
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, std::vector<unsigned char>& value_)
+    {
+        const unsigned char* _blob = (const unsigned char*)sqlite3_column_blob(statement_, column_);
+        if (_blob == nullptr) {
+            value_.clear();
+        } else {
+            value_.assign(_blob, _blob + sqlite3_column_bytes(statement_, column_));
         }
-    };
-    // int
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, int, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        int& _ref;
-        
-        OSTypeOp(int& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::get<NUM>(tuple_) = sqlite3_column_int(statement_, NUM);
-            OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
+    }
+    template <typename T>
+    inline void OSColumnAssign(sqlite3_stmt* statement_, int column_, OSNullable<T>& value_)
+    {
+        if (sqlite3_column_type(statement_, column_) == SQLITE_NULL) {
+            value_.setNull();
+        } else {
+            T _value;
+            OSColumnAssign(statement_, column_, _value);
+            value_.setValue(_value);
         }
-        
-        template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, int& iValue_, Args&... args_) {
-            int _result = sqlite3_bind_int(statement_, NUM+1, iValue_);
-            if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind int failed.", _result);
-            }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
+    }
+    
+    // Text and blobs are bound with destructor_: SQLITE_STATIC when the
+    // value outlives the step (no copy), SQLITE_TRANSIENT otherwise.
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const int& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_int(statement_, index_, value_);}
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const unsigned int& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_int(statement_, index_, (int)value_);}
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const long& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_int64(statement_, index_, value_);}
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const unsigned long& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_int64(statement_, index_, (sqlite3_int64)value_);}
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const float& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_double(statement_, index_, value_);}
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const double& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_double(statement_, index_, value_);}
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const std::string& value_, sqlite3_destructor_type destructor_)
+    {return sqlite3_bind_text(statement_, index_, value_.c_str(), (int)value_.length(), destructor_);}
+    // String literals and C strings; nullptr binds NULL.
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const char* value_, sqlite3_destructor_type destructor_)
+    {
+        if (value_ == nullptr) {
+            return sqlite3_bind_null(statement_, index_);
         }
-        
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            _ref = sqlite3_column_int(statement_, NUM);
-            _next.queryReturnAssign(statement_);
+        return sqlite3_bind_text(statement_, index_, value_, -1, destructor_);
+    }
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const OSTextView& value_, sqlite3_destructor_type destructor_)
+    {
+        if (value_.isNull()) {
+            return sqlite3_bind_null(statement_, index_);
         }
-        
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_bind_int(statement_, NUM+1, _ref);
-            if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind int failed.", _result);
-            }
-            _next.queryParamBinding(statement_);
+        return sqlite3_bind_text(statement_, index_, value_.data, (int)value_.size, destructor_);
+    }
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const OSBlobView& value_, sqlite3_destructor_type destructor_)
+    {
+        if (value_.isNull()) {
+            return sqlite3_bind_null(statement_, index_);
         }
-        
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
+        return sqlite3_bind_blob(statement_, index_, value_.data, (int)value_.size, destructor_);
+    }
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const std::vector<unsigned char>& value_, sqlite3_destructor_type destructor_)
+    {
+        // An empty vector is an empty blob, not NULL.
+        return sqlite3_bind_blob(statement_, index_, value_.empty() ? "" : (const void*)value_.data(), (int)value_.size(), destructor_);
+    }
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const OSZeroBlob& value_, sqlite3_destructor_type)
+    {return sqlite3_bind_zeroblob(statement_, index_, (int)value_.size);}
+    template <typename T>
+    inline int OSParamBind(sqlite3_stmt* statement_, int index_, const OSNullable<T>& value_, sqlite3_destructor_type destructor_)
+    {
+        if (value_.isNull()) {
+            return sqlite3_bind_null(statement_, index_);
         }
-    };
-    // unsigned int
+        return OSParamBind(statement_, index_, value_.value(), destructor_);
+    }
+    
+    // Heap bytes held by a value, for the memory budget of OSObjectCache.
+    template <typename T>
+    inline size_t OSValueBytes(const T&)
+    {return 0;}
+    inline size_t OSValueBytes(const std::string& value_)
+    {return value_.capacity();}
+    inline size_t OSValueBytes(const std::vector<unsigned char>& value_)
+    {return value_.capacity();}
+    template <typename T>
+    inline size_t OSValueBytes(const OSNullable<T>& value_)
+    {return value_.isNull() ? 0 : OSValueBytes(value_.value());}
+    
+    // A primary key as the key of OSObjectCache: the bytes of a number (-0.0
+    // is 0.0), the text of a string, a marker byte before a nullable.
+    template <typename T>
+    inline std::string OSCacheKey(const T& value_)
+    {
+        static_assert(std::is_arithmetic<T>::value, "OSCacheKey: unsupported primary key type.");
+        const T _value = std::is_floating_point<T>::value && value_ == 0 ? 0 : value_;
+        return std::string(reinterpret_cast<const char*>(&_value), sizeof(_value));
+    }
+    inline std::string OSCacheKey(const std::string& value_)
+    {return value_;}
+    inline std::string OSCacheKey(const std::vector<unsigned char>& value_)
+    {return std::string(value_.begin(), value_.end());}
+    template <typename T>
+    inline std::string OSCacheKey(const OSNullable<T>& value_)
+    {return value_.isNull() ? std::string(1, '\0') : '\1' + OSCacheKey(value_.value());}
+    
+    
+    // Define a templated struct named OSTypeOp, used to encapsulate type
+    // bindings from database to clients, or vice versa. (at compile-time)
+    // Values go through the OSColumnAssign / OSParamBind overloads above, so
+    // an unsupported type is a compile error.
+    //
+    // Funtions:
+    //      statementReturnAssign: extract data from database to the tuple
+    //      statementParamBinding: bind parameters to sql - for OSStatement operations.
+    //          Any argument is taken: const, temporaries, string literals.
+    //      tupleParamBinding: bind the elements of a tuple as parameters
+    //      queryReturnAssign: OSQuery operations extracting data into an object
+    //      queryParamBinding: OSQuery operations bind params from an object
+    //      queryKeyBinding: OSQuery operations bind the primary key (the first key)
+    //      rowStore, rowAssign, rowBytes, queryCacheKey: copy the keys of an
+    //          object into a tuple kept by OSObjectCache and back.
+    // The query functions find the keys of an object at the offsets registered
+    // by OSTablePolicy, so no per-object binding data is needed. The object
+    // outlives the step, so its text and blobs are bound without a copy.
+    //
+    // All functions may throw OSException.
+    // Providing types including: int, unsigned int, long, unsigned long, float,
+    // double, std::string, std::vector<unsigned char> (blob), OSNullable<T>,
+    // OSTextView, OSBlobView, and OSZeroBlob for parameters only.
     template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, unsigned int, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        unsigned int& _ref;
+    struct OSTypeOp {
         
-        OSTypeOp(unsigned int& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
         template <typename... Returns>
         static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::get<NUM>(tuple_) = (unsigned int)sqlite3_column_int(statement_, NUM);
-            OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
-        }
-        
-        template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, unsigned int& iValue_, Args&... args_) {
-            int _result = sqlite3_bind_int(statement_, NUM+1, iValue_);
-            if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind unsigned int failed.", _result);
-            }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
-        }
-        
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            _ref = (unsigned int)sqlite3_column_int(statement_, NUM);
-            _next.queryReturnAssign(statement_);
-        }
-        
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_bind_int(statement_, NUM+1, _ref);
-            if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind unsigned int failed.", _result);
-            }
-            _next.queryParamBinding(statement_);
-        }
-        
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
+            // End of recursive type binding. Do nothing.
         }
-    };
-    // long
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, long, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        long& _ref;
         
-        OSTypeOp(long& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::get<NUM>(tuple_) = sqlite3_column_int64(statement_, NUM);
-            OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
+        static inline void statementParamBinding(sqlite3_stmt* statement_, sqlite3_destructor_type destructor_) {
+            // End of recursive type binding. Do nothing.
         }
         
         template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, long& lValue_, Args&... args_) {
-            int _result = sqlite3_bind_int64(statement_, NUM+1, lValue_);
-            if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind long failed.", _result);
-            }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
-        }
-        
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            _ref = (long)sqlite3_column_int64(statement_, NUM);
-            _next.queryReturnAssign(statement_);
-        }
-        
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_column_int64(statement_, NUM+1, _ref);
-            if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind long failed.", _result);
-            }
-            _next.queryParamBinding(statement_);
-        }
-        
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
+        static inline void tupleParamBinding(const std::tuple<Params...>& tuple_, sqlite3_stmt* statement_, sqlite3_destructor_type destructor_) {
+            // End of recursive type binding. Do nothing.
         }
-    };
-    // unsigned long
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, unsigned long, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        unsigned long& _ref;
         
-        OSTypeOp(unsigned long& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::get<NUM>(tuple_) = (unsigned long)sqlite3_column_int(statement_, NUM);
-            OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
+        static inline void queryReturnAssign(char* object_, const ptrdiff_t* offsets_, sqlite3_stmt* statement_) {
+            // End of recursive type binding. Do nothing.
         }
         
-        template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, unsigned long& lValue_, Args&... args_) {
-            int _result = sqlite3_bind_int64(statement_, NUM+1, lValue_);
-            if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind unsigned long failed.", _result);
-            }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
+        static inline void queryParamBinding(const char* object_, const ptrdiff_t* offsets_, sqlite3_stmt* statement_) {
+            // End of recursive type binding. Do nothing.
         }
         
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            _ref = (unsigned long)sqlite3_column_int64(statement_, NUM);
-            _next.queryReturnAssign(statement_);
+        template <typename... Values>
+        static inline void rowStore(const char* object_, const ptrdiff_t* offsets_, std::tuple<Values...>& row_) {
+            // End of recursive type binding. Do nothing.
         }
         
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_column_int64(statement_, NUM+1, _ref);
-            if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind unsigned long failed.", _result);
-            }
-            _next.queryParamBinding(statement_);
+        template <typename... Values>
+        static inline void rowAssign(char* object_, const ptrdiff_t* offsets_, const std::tuple<Values...>& row_) {
+            // End of recursive type binding. Do nothing.
         }
         
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
+        template <typename... Values>
+        static inline size_t rowBytes(const std::tuple<Values...>& row_) {
+            return 0;
         }
     };
-    // float. Warning: might lose data.
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, float, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        float& _ref;
+    template <unsigned char NUM, typename T, typename... Args>
+    struct OSTypeOp<NUM, T, Args...> {
         
-        OSTypeOp(float& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
         template <typename... Returns>
         static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::get<NUM>(tuple_) = (float)(sqlite3_column_double(statement_, NUM));
+            OSColumnAssign(statement_, NUM, std::get<NUM>(tuple_));
             OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
         }
         
-        template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, float& fValue_, Args&... args_) {
-            int _result = sqlite3_bind_double(statement_, NUM+1, fValue_);
+        static inline void statementParamBinding(sqlite3_stmt* statement_, sqlite3_destructor_type destructor_, const T& value_, const Args&... args_) {
+            int _result = OSParamBind(statement_, NUM+1, value_, destructor_);
             if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind float failed.", _result);
+                throw OSException("statementParamBinding error. Bind parameter failed.", _result);
             }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
-        }
-        
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            _ref = (float)(sqlite3_column_double(statement_, NUM));
-            _next.queryReturnAssign(statement_);
+            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, destructor_, args_...);
         }
         
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_bind_double(statement_, NUM+1, _ref);
+        template <typename... Params>
+        static inline void tupleParamBinding(const std::tuple<Params...>& tuple_, sqlite3_stmt* statement_, sqlite3_destructor_type destructor_) {
+            int _result = OSParamBind(statement_, NUM+1, std::get<NUM>(tuple_), destructor_);
             if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind float failed.", _result);
+                throw OSException("tupleParamBinding error. Bind parameter failed.", _result);
             }
-            _next.queryParamBinding(statement_);
-        }
-        
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
+            OSTypeOp<NUM+1, Args...>::tupleParamBinding(tuple_, statement_, destructor_);
         }
-    };
-    // double
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, double, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        double& _ref;
         
-        OSTypeOp(double& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::get<NUM>(tuple_) = (double)sqlite3_column_double(statement_, NUM);
-            OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
+        static inline void queryReturnAssign(char* object_, const ptrdiff_t* offsets_, sqlite3_stmt* statement_) {
+            OSColumnAssign(statement_, NUM, *reinterpret_cast<T*>(object_ + offsets_[NUM]));
+            OSTypeOp<NUM+1, Args...>::queryReturnAssign(object_, offsets_, statement_);
         }
         
-        template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, double& dValue_, Args&... args_) {
-            int _result = sqlite3_bind_double(statement_, NUM+1, dValue_);
+        static inline void queryParamBinding(const char* object_, const ptrdiff_t* offsets_, sqlite3_stmt* statement_) {
+            int _result = OSParamBind(statement_, NUM+1, *reinterpret_cast<const T*>(object_ + offsets_[NUM]), SQLITE_STATIC);
             if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind double failed.", _result);
+                throw OSException("queryParamBinding error. Bind key failed.", _result);
             }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
-        }
-        
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            _ref = (double)(sqlite3_column_double(statement_, NUM));
-            _next.queryReturnAssign(statement_);
+            OSTypeOp<NUM+1, Args...>::queryParamBinding(object_, offsets_, statement_);
         }
         
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_bind_double(statement_, NUM+1, _ref);
+        static inline void queryKeyBinding(const char* object_, const ptrdiff_t* offsets_, sqlite3_stmt* statement_, int index_) {
+            int _result = OSParamBind(statement_, index_, *reinterpret_cast<const T*>(object_ + offsets_[NUM]), SQLITE_STATIC);
             if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind double failed.", _result);
+                throw OSException("queryKeyBinding error. Bind primary key failed.", _result);
             }
-            _next.queryParamBinding(statement_);
-        }
-        
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
-        }
-    };
-    // std::string
-    template <unsigned char NUM, typename... Args>
-    struct OSTypeOp<NUM, std::string, Args...> : virtual public OSPlaceHolder {
-        OSTypeOp<NUM+1, Args...> _next;
-        std::string& _ref;
-        
-        OSTypeOp(std::string& iValue_, Args&... args_):_ref(iValue_), _next(args_...){}
-		virtual ~OSTypeOp(){}
-
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            std::string sValue((const char*)sqlite3_column_text(statement_, NUM));
-            std::get<NUM>(tuple_) = sValue;
-            OSTypeOp<NUM+1, Args...>::statementReturnAssign(tuple_, statement_);
         }
         
-        template <typename... Params>
-        static inline void statementParamBinding(sqlite3_stmt* statement_, std::string& sValue_, Args&... args_) {
-            int _result = sqlite3_bind_text(statement_, NUM+1, sValue_.c_str(), (int)sValue_.length(), SQLITE_TRANSIENT);
-            if (_result != SQLITE_OK) {
-                throw OSException("statementParamBinding error. Bind std::string failed.", _result);
-            }
-            OSTypeOp<NUM+1, Args...>::statementParamBinding(statement_, args_...);
+        template <typename... Values>
+        static inline void rowStore(const char* object_, const ptrdiff_t* offsets_, std::tuple<Values...>& row_) {
+            std::get<NUM>(row_) = *reinterpret_cast<const T*>(object_ + offsets_[NUM]);
+            OSTypeOp<NUM+1, Args...>::rowStore(object_, offsets_, row_);
         }
         
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            std::string sValue((const char*)sqlite3_column_text(statement_, NUM));
-            _ref = sValue;
-            _next.queryReturnAssign(statement_);
+        template <typename... Values>
+        static inline void rowAssign(char* object_, const ptrdiff_t* offsets_, const std::tuple<Values...>& row_) {
+            *reinterpret_cast<T*>(object_ + offsets_[NUM]) = std::get<NUM>(row_);
+            OSTypeOp<NUM+1, Args...>::rowAssign(object_, offsets_, row_);
         }
         
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            int _result = sqlite3_bind_text(statement_, NUM+1, _ref.c_str(), (int)_ref.length(), SQLITE_TRANSIENT);
-            if (_result != SQLITE_OK) {
-                throw OSException("queryParamBinding error. Bind std::string failed.", _result);
-            }
-            _next.queryParamBinding(statement_);
+        template <typename... Values>
+        static inline size_t rowBytes(const std::tuple<Values...>& row_) {
+            return OSValueBytes(std::get<NUM>(row_)) + OSTypeOp<NUM+1, Args...>::rowBytes(row_);
         }
         
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            sqlStream_ << _ref;
+        static inline std::string queryCacheKey(const char* object_, const ptrdiff_t* offsets_) {
+            return OSCacheKey(*reinterpret_cast<const T*>(object_ + offsets_[NUM]));
         }
     };
     
-    template <unsigned char NUM>
-    struct OSTypeOp<NUM> : virtual public OSPlaceHolder {
-        
-        OSTypeOp() {}
-		virtual ~OSTypeOp(){}
+    // OSTupleBind, binds a tuple of parameters with OSTypeOp (the types are
+    // deduced from the tuple).
+    template <typename... Params>
+    inline void OSTupleBind(sqlite3_stmt* statement_, const std::tuple<Params...>& tuple_, sqlite3_destructor_type destructor_)
+    {
+        OSTypeOp<0, Params...>::tupleParamBinding(tuple_, statement_, destructor_);
+    }
+    
+    // OSObjectRow, the OSObjectRowOps of a table type: its rows are tuples of
+    // the key types.
+    template <typename... Args>
+    struct OSObjectRow {
+        typedef std::tuple<Args...> Row;
         
-        template <typename... Returns>
-        static inline void statementReturnAssign(std::tuple<Returns...>& tuple_, sqlite3_stmt* statement_) {
-            // End of recursive type binding. Do nothing.
+        static void* create(const char* object_, const ptrdiff_t* offsets_) {
+            std::unique_ptr<Row> _row(new Row());
+            OSTypeOp<0, Args...>::rowStore(object_, offsets_, *_row);
+            return _row.release();
         }
-        
-        static inline void statementParamBinding(sqlite3_stmt* statement_) {
-            // End of recursive type binding. Do nothing.
+        static void assign(char* object_, const ptrdiff_t* offsets_, const void* row_) {
+            OSTypeOp<0, Args...>::rowAssign(object_, offsets_, *static_cast<const Row*>(row_));
         }
-        
-        virtual inline void queryReturnAssign(sqlite3_stmt* statement_) override {
-            // End of recursive type binding. Do nothing.
+        static void destroy(void* row_) {
+            delete static_cast<Row*>(row_);
         }
-        
-        virtual inline void queryParamBinding(sqlite3_stmt* statement_) override {
-            // End of recursive type binding. Do nothing.
+        static size_t bytes(const void* row_) {
+            return sizeof(Row) + OSTypeOp<0, Args...>::rowBytes(*static_cast<const Row*>(row_));
+        }
+        static std::string key(const char* object_, const ptrdiff_t* offsets_) {
+            return OSTypeOp<0, Args...>::queryCacheKey(object_, offsets_);
         }
         
-        virtual inline void queryPrimaryKey(std::stringstream& sqlStream_) override {
-            // End of recursive type binding. Do nothing.
+        static const OSObjectRowOps operations;
+    };
+    template <typename... Args>
+    const OSObjectRowOps OSObjectRow<Args...>::operations = {&OSObjectRow<Args...>::create, &OSObjectRow<Args...>::assign, &OSObjectRow<Args...>::destroy, &OSObjectRow<Args...>::bytes, &OSObjectRow<Args...>::key};
+    
+    // OSHasView, true if any of the types is a view. Views must not be
+    // kept after the statement steps, so executeRows and executeScalar reject them.
+    template <typename... Types>
+    struct OSHasView : std::false_type {};
+    template <typename... Types>
+    struct OSHasView<OSTextView, Types...> : std::true_type {};
+    template <typename... Types>
+    struct OSHasView<OSBlobView, Types...> : std::true_type {};
+    template <typename T, typename... Types>
+    struct OSHasView<T, Types...> : OSHasView<Types...> {};
+    
+    // OSColumnsOp, appends the current row to a tuple of column vectors.
+    template <unsigned char NUM, typename... Columns>
+    struct OSColumnsOp {
+        template <typename... Vectors>
+        static inline void append(std::tuple<Vectors...>& columns_, sqlite3_stmt* statement_) {}
+    };
+    template <unsigned char NUM, typename T, typename... Columns>
+    struct OSColumnsOp<NUM, T, Columns...> {
+        template <typename... Vectors>
+        static inline void append(std::tuple<Vectors...>& columns_, sqlite3_stmt* statement_) {
+            auto& _column = std::get<NUM>(columns_);
+            _column.emplace_back();
+            OSColumnAssign(statement_, NUM, _column.back());
+            OSColumnsOp<NUM+1, Columns...>::append(columns_, statement_);
         }
     };
     
     
     
     
+    // OSElementTraits, get the mapped object from an element of a range used
+    // by the OSQuery bulk functions. Elements can be objects or pointers.
+    template <typename Element>
+    struct OSElementTraits {
+        typedef Element Table;
+        static inline Table& object(Element& element_) {return element_;}
+    };
+    template <typename Element>
+    struct OSElementTraits<Element*> {
+        typedef Element Table;
+        static inline Table& object(Element* element_) {return *element_;}
+    };
+    template <typename Element>
+    struct OSElementTraits<std::unique_ptr<Element>> {
+        typedef Element Table;
+        static inline Table& object(const std::unique_ptr<Element>& element_) {return *element_;}
+    };
+    template <typename Element>
+    struct OSElementTraits<std::shared_ptr<Element>> {
+        typedef Element Table;
+        static inline Table& object(const std::shared_ptr<Element>& element_) {return *element_;}
+    };
     
-    // Functions for OSException
-    OSException::OSException() noexcept : _content("OSLite exception"), _tag(0)
-    {}
     
-    OSException::OSException(const char* content_) noexcept : _content(content_), _tag(0)
-    {}
     
-    OSException::OSException(const char* content_, unsigned tag_) noexcept : _content(content_), _tag(tag_)
+    
+    // Functions for OSTextView, OSBlobView
+    inline bool OSTextView::isNull() const noexcept
+    {return data == nullptr;}
+    
+    inline std::string OSTextView::str() const
+    {return data == nullptr ? std::string() : std::string(data, size);}
+    
+    inline bool OSTextView::operator==(const std::string& other_) const noexcept
+    {return size == other_.size() && (size == 0 || memcmp(data, other_.data(), size) == 0);}
+    
+    inline bool OSTextView::operator!=(const std::string& other_) const noexcept
+    {return !(*this == other_);}
+    
+    inline OSBlobView::OSBlobView(const void* data_, size_t size_) noexcept : data((const unsigned char*)data_), size(size_)
     {}
     
-    OSException::~OSException() noexcept
+    inline bool OSBlobView::isNull() const noexcept
+    {return data == nullptr;}
+    
+    inline OSZeroBlob::OSZeroBlob(size_t size_) noexcept : size(size_)
     {}
     
-    const char* OSException::what() const noexcept
-    {return _content.c_str();}
     
-    const unsigned OSException::tag() const noexcept
-    {return _tag;}
     
     
+    // Functions for OSNullable
+    template <typename T>
+    OSNullable<T>::OSNullable() : _value(), _null(true)
+    {}
     
+    template <typename T>
+    OSNullable<T>::OSNullable(const T& value_) : _value(value_), _null(false)
+    {}
     
-    // Functions for OSTablePolicy
-    template <class _DerivedCLS_>
-    template <typename... Args>
-    OSTablePolicy<_DerivedCLS_>::OSTablePolicy(const std::string& tableName_, std::initializer_list<std::string> keyNamesList_, Args&... args_) throw(OSException)
+    template <typename T>
+    inline bool OSNullable<T>::isNull() const noexcept
+    {return _null;}
+    
+    template <typename T>
+    inline const T& OSNullable<T>::value() const noexcept
+    {return _value;}
+    
+    template <typename T>
+    inline void OSNullable<T>::setValue(const T& value_)
     {
-        if (!_hasBindings) {
-            _tableName = tableName_;
-            _keyNameVec = keyNamesList_;
-            _hasBindings = true;
-        }
-        _keyReference = new OSTypeOp<0, Args...>(args_...);
+        _value = value_;
+        _null = false;
     }
     
-    template <class _DerivedCLS_>
-    OSTablePolicy<_DerivedCLS_>::~OSTablePolicy()
+    template <typename T>
+    inline void OSNullable<T>::setNull() noexcept
     {
-        if (_keyReference != nullptr) {
-            delete _keyReference;
-            _keyReference = nullptr;
-        }
+        _value = T();
+        _null = true;
     }
     
-    template <class _DerivedCLS_>
-    bool OSTablePolicy<_DerivedCLS_>::checkBindings()
+    
+    
+    
+    // Functions for OSAlignedAllocator
+    template <typename T, size_t Alignment>
+    inline T* OSAlignedAllocator<T, Alignment>::allocate(size_t count_)
     {
-        return _hasBindings && _keyNameVec.size()>1;
+        void* _pointer = nullptr;
+#ifdef _MSC_VER
+        _pointer = _aligned_malloc(count_ * sizeof(T), Alignment);
+#else
+        if (posix_memalign(&_pointer, Alignment, count_ * sizeof(T)) != 0) {
+            _pointer = nullptr;
+        }
+#endif
+        if (_pointer == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(_pointer);
+    }
+    
+    template <typename T, size_t Alignment>
+    inline void OSAlignedAllocator<T, Alignment>::deallocate(T* pointer_, size_t count_) noexcept
+    {
+#ifdef _MSC_VER
+        _aligned_free(pointer_);
+#else
+        free(pointer_);
+#endif
     }
     
     
     
-    // Functions for OSQuery
-    OSQuery::OSQuery(const OSDatabase& database_) throw(OSException) : _connection(database_._connection)
+    
+    // Functions for OSMemoryPool
+    struct OSMemoryPool::State {
+        // Payloads of 16 << i bytes; blocks have a 16-byte header before.
+        static const size_t classCount = 9;
+        static const size_t chunkSize = 65536;
+        struct Header {
+            size_t size;
+            size_t sizeClass;
+        };
+        struct Class {
+            std::mutex mutex;
+            Header* freeList = nullptr;
+        };
+        Class classes[classCount];
+        
+        std::atomic<unsigned long long> allocations;
+        std::atomic<unsigned long long> frees;
+        std::atomic<unsigned long long> largeAllocations;
+        std::atomic<size_t> bytesInUse;
+        std::atomic<size_t> peakBytesInUse;
+        std::atomic<size_t> bytesReserved;
+        // Connections open, which configure() must not pull SQLite from under.
+        std::atomic<size_t> connections;
+        
+        // Guarded by configure(): SQLite's own allocator and our page cache.
+        std::mutex configureMutex;
+        sqlite3_mem_methods original;
+        bool haveOriginal = false;
+        void* pageCache = nullptr;
+        
+        State() noexcept : allocations(0), frees(0), largeAllocations(0), bytesInUse(0), peakBytesInUse(0), bytesReserved(0), connections(0) {}
+    };
+    
+    inline OSMemoryPool::State& OSMemoryPool::state() noexcept
     {
-        if (_connection == nullptr) {
-            throw OSException("OSStatement ctor error: SQLite connection is not opened.");
-        }
+        // Never destroyed: SQLite may free into the pool at exit.
+        static State* _state = new State;
+        return *_state;
     }
     
-    OSQuery::~OSQuery()
+    inline size_t OSMemoryPool::sizeClass(size_t size_) noexcept
     {
-        if (_statement != nullptr) {
-            sqlite3_finalize(_statement);
-            _statement = nullptr;
-        }
+        size_t _class = 0;
+        while (_class < State::classCount && ((size_t)16 << _class) < size_)
+            ++_class;
+        return _class;
     }
     
-    template <typename Table>
-    typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type OSQuery::save(Table& table_) throw(OSException)
+    inline void* OSMemoryPool::allocate(size_t size_) noexcept
     {
-        try {
-            // Check the acceptance of table binding
-            if (!table_.checkBindings()) {
-                throw OSException("save error: table binding is not acceptable.");
-            }
-            
-            // Construct the SQL string and fill in data
-            std::string _sqlString = "insert into " + table_._tableName + "(";
-            std::string _endString = " values(";
-            for (auto& _str : table_._keyNameVec) {
-                _sqlString += _str;
-                _sqlString +=",";
-                _endString +="?,";
-            }
-            _sqlString[_sqlString.size()-1] = ')';
-            _endString[_endString.size()-1] = ')';
-            _sqlString += _endString;
-            
-            // Prepare statement first.
-            int _result = sqlite3_prepare_v2(_connection, _sqlString.c_str(), (int)_sqlString.size(), &_statement, nullptr);
-            if (_result != SQLITE_OK) {
-                throw OSException("save error: Cannot prepare the sqlite3_stmt.", _result);
-            }
-            
-            // Parameter binding.
-            table_._keyReference->queryParamBinding(_statement);
-            
-            // Execute
-            _result = sqlite3_step(_statement);
-            if (_result != SQLITE_DONE) {
-                throw OSException("save error. Execute SQLString failed.", _result);
+        State& _state = state();
+        size_t _class = sizeClass(size_);
+        State::Header* _header = nullptr;
+        if (_class == State::classCount) {
+            _header = static_cast<State::Header*>(malloc(sizeof(State::Header) + size_));
+            if (_header == nullptr)
+                return nullptr;
+            _header->size = size_;
+            _state.largeAllocations.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            State::Class& _sizeClass = _state.classes[_class];
+            size_t _blockSize = sizeof(State::Header) + ((size_t)16 << _class);
+            std::lock_guard<std::mutex> _lock(_sizeClass.mutex);
+            if (_sizeClass.freeList == nullptr) {
+                char* _chunk = static_cast<char*>(malloc(State::chunkSize));
+                if (_chunk == nullptr)
+                    return nullptr;
+                _state.bytesReserved.fetch_add(State::chunkSize, std::memory_order_relaxed);
+                // The free list links through the size field of the headers.
+                for (size_t _offset = 0; _offset + _blockSize <= State::chunkSize; _offset += _blockSize) {
+                    State::Header* _block = reinterpret_cast<State::Header*>(_chunk + _offset);
+                    _block->size = reinterpret_cast<size_t>(_sizeClass.freeList);
+                    _sizeClass.freeList = _block;
+                }
             }
-            
-            sqlite3_finalize(_statement);
-            _statement = nullptr;
-        } catch (const OSException&) {
-            sqlite3_finalize(_statement);
-            _statement = nullptr;
-            throw;
-        }
+            _header = _sizeClass.freeList;
+            _sizeClass.freeList = reinterpret_cast<State::Header*>(_header->size);
+            _header->size = (size_t)16 << _class;
+        }
+        _header->sizeClass = _class;
+        _state.allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t _inUse = _state.bytesInUse.fetch_add(_header->size, std::memory_order_relaxed) + _header->size;
+        size_t _peak = _state.peakBytesInUse.load(std::memory_order_relaxed);
+        while (_inUse > _peak && !_state.peakBytesInUse.compare_exchange_weak(_peak, _inUse, std::memory_order_relaxed)) {}
+        return _header + 1;
     }
     
-    template <typename Table>
-    typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type OSQuery::exists(Table& table_) throw(OSException)
+    inline void OSMemoryPool::deallocate(void* pointer_) noexcept
+    {
+        if (pointer_ == nullptr)
+            return;
+        State& _state = state();
+        State::Header* _header = static_cast<State::Header*>(pointer_) - 1;
+        _state.frees.fetch_add(1, std::memory_order_relaxed);
+        _state.bytesInUse.fetch_sub(_header->size, std::memory_order_relaxed);
+        if (_header->sizeClass == State::classCount) {
+            free(_header);
+            return;
+        }
+        State::Class& _sizeClass = _state.classes[_header->sizeClass];
+        std::lock_guard<std::mutex> _lock(_sizeClass.mutex);
+        _header->size = reinterpret_cast<size_t>(_sizeClass.freeList);
+        _sizeClass.freeList = _header;
+    }
+    
+    inline void* OSMemoryPool::reallocate(void* pointer_, size_t size_) noexcept
+    {
+        if (pointer_ == nullptr)
+            return allocate(size_);
+        size_t _size = size(pointer_);
+        State::Header* _header = static_cast<State::Header*>(pointer_) - 1;
+        if (size_ <= _size && _header->sizeClass != State::classCount)
+            return pointer_;
+        void* _pointer = allocate(size_);
+        if (_pointer == nullptr)
+            return nullptr;
+        memcpy(_pointer, pointer_, std::min(_size, size_));
+        deallocate(pointer_);
+        return _pointer;
+    }
+    
+    inline size_t OSMemoryPool::size(void* pointer_) noexcept
+    {
+        return pointer_ == nullptr ? 0 : (static_cast<State::Header*>(pointer_) - 1)->size;
+    }
+    
+    inline void* OSMemoryPool::sqliteMalloc(int size_)
+    {return allocate((size_t)size_);}
+    
+    inline void OSMemoryPool::sqliteFree(void* pointer_)
+    {deallocate(pointer_);}
+    
+    inline void* OSMemoryPool::sqliteRealloc(void* pointer_, int size_)
+    {return reallocate(pointer_, (size_t)size_);}
+    
+    inline int OSMemoryPool::sqliteSize(void* pointer_)
+    {return (int)size(pointer_);}
+    
+    inline int OSMemoryPool::sqliteRoundup(int size_)
+    {
+        size_t _class = sizeClass((size_t)size_);
+        return _class == State::classCount ? (size_ + 7) & ~7 : 16 << _class;
+    }
+    
+    inline int OSMemoryPool::sqliteInit(void*)
+    {return SQLITE_OK;}
+    
+    inline void OSMemoryPool::sqliteShutdown(void*)
+    {}
+    
+    inline void OSMemoryPool::configure(const OSMemoryOptions& options_) throw(OSException)
     {
-        // Check the acceptance of table binding
-        if (!table_.checkBindings()) {
-            throw OSException("exists error: table binding is not acceptable.");
+        State& _state = state();
+        std::lock_guard<std::mutex> _lock(_state.configureMutex);
+        // sqlite3_shutdown succeeds even then, and the blocks of the open
+        // connections would go to the wrong allocator.
+        if (_state.connections.load() != 0) {
+            throw OSException("configure error: A connection is open.", SQLITE_MISUSE);
+        }
+        int _result = sqlite3_shutdown();
+        if (_result != SQLITE_OK) {
+            throw OSException("configure error: Cannot shut SQLite down.", _result);
         }
+        if (!_state.haveOriginal) {
+            sqlite3_config(SQLITE_CONFIG_GETMALLOC, &_state.original);
+            _state.haveOriginal = true;
+        }
+        static sqlite3_mem_methods _methods = {&sqliteMalloc, &sqliteFree, &sqliteRealloc, &sqliteSize, &sqliteRoundup, &sqliteInit, &sqliteShutdown, nullptr};
+        _result = sqlite3_config(SQLITE_CONFIG_MALLOC, options_.pool ? &_methods : &_state.original);
         
-        // Process select count operations to check if the data exists
-        // Construct the SQL string and fill in data directly
-        std::stringstream _sqlStream;
-        _sqlStream << "select count(*) from " << table_._tableName << " where " << table_._keyNameVec[0] << "='";
-        table_._keyReference->queryPrimaryKey(_sqlStream);
-        _sqlStream << "'";
-        std::string _sqlString = _sqlStream.str();
+        // SQLite is shut down, so the old page cache buffer is unused.
+        free(_state.pageCache);
+        _state.pageCache = nullptr;
+        if (_result == SQLITE_OK && options_.pageCacheSlots > 0) {
+            _state.pageCache = malloc(options_.pageCacheSlotSize * options_.pageCacheSlots);
+            if (_state.pageCache == nullptr) {
+                throw OSException("configure error: Cannot allocate the page cache.", SQLITE_NOMEM);
+            }
+        }
+        if (_result == SQLITE_OK) {
+            _result = sqlite3_config(SQLITE_CONFIG_PAGECACHE, _state.pageCache, (int)options_.pageCacheSlotSize, (int)options_.pageCacheSlots);
+        }
+        if (_result == SQLITE_OK && options_.lookasideSlotSize >= 0 && options_.lookasideSlots >= 0) {
+            _result = sqlite3_config(SQLITE_CONFIG_LOOKASIDE, options_.lookasideSlotSize, options_.lookasideSlots);
+        }
+        if (_result != SQLITE_OK) {
+            throw OSException("configure error: sqlite3_config failed.", _result);
+        }
+        _result = sqlite3_initialize();
+        if (_result != SQLITE_OK) {
+            throw OSException("configure error: Cannot initialize SQLite.", _result);
+        }
+    }
+    
+    inline void OSMemoryPool::connectionOpened() noexcept
+    {
+        state().connections.fetch_add(1);
+    }
+    
+    inline void OSMemoryPool::connectionClosed() noexcept
+    {
+        state().connections.fetch_sub(1);
+    }
+    
+    inline OSMemoryStatistics OSMemoryPool::statistics() noexcept
+    {
+        State& _state = state();
+        OSMemoryStatistics _statistics;
+        _statistics.allocations = _state.allocations.load(std::memory_order_relaxed);
+        _statistics.frees = _state.frees.load(std::memory_order_relaxed);
+        _statistics.largeAllocations = _state.largeAllocations.load(std::memory_order_relaxed);
+        _statistics.bytesInUse = _state.bytesInUse.load(std::memory_order_relaxed);
+        _statistics.peakBytesInUse = _state.peakBytesInUse.load(std::memory_order_relaxed);
+        _statistics.bytesReserved = _state.bytesReserved.load(std::memory_order_relaxed);
+        sqlite3_int64 _highwater = 0;
+        sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &_statistics.sqliteMemoryUsed, &_highwater, 0);
+        _statistics.sqliteMemoryHighwater = _highwater;
+        sqlite3_status64(SQLITE_STATUS_PAGECACHE_USED, &_statistics.pageCacheUsed, &_highwater, 0);
+        sqlite3_status64(SQLITE_STATUS_PAGECACHE_OVERFLOW, &_statistics.pageCacheOverflow, &_highwater, 0);
+        return _statistics;
+    }
+    
+    
+    
+    
+    // Functions for OSPoolAllocator
+    template <typename T>
+    inline T* OSPoolAllocator<T>::allocate(size_t count_)
+    {
+        void* _pointer = OSMemoryPool::allocate(count_ * sizeof(T));
+        if (_pointer == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(_pointer);
+    }
+    
+    template <typename T>
+    inline void OSPoolAllocator<T>::deallocate(T* pointer_, size_t count_) noexcept
+    {
+        OSMemoryPool::deallocate(pointer_);
+    }
+    
+    
+    
+    
+    // Functions for OSReduce
+    template <typename T, typename A>
+    inline typename std::conditional<std::is_floating_point<T>::value, double, long long>::type OSReduce::sum(const std::vector<T, A>& column_)
+    {
+        typedef typename std::conditional<std::is_floating_point<T>::value, double, long long>::type _Sum;
+        const T* _data = column_.data();
+        const size_t _size = column_.size();
+        // Four accumulators break the dependency chain of a single one.
+        _Sum _sum0 = 0, _sum1 = 0, _sum2 = 0, _sum3 = 0;
+        size_t _i = 0;
+        for (; _i + 4 <= _size; _i += 4) {
+            _sum0 += _data[_i];
+            _sum1 += _data[_i+1];
+            _sum2 += _data[_i+2];
+            _sum3 += _data[_i+3];
+        }
+        for (; _i < _size; ++_i) {
+            _sum0 += _data[_i];
+        }
+        return (_sum0 + _sum1) + (_sum2 + _sum3);
+    }
+    
+    template <typename T, typename A>
+    inline T OSReduce::min(const std::vector<T, A>& column_) throw(OSException)
+    {
+        if (column_.empty()) {
+            throw OSException("OSReduce error: min of an empty column.");
+        }
+        const T* _data = column_.data();
+        const size_t _size = column_.size();
+        T _min = _data[0];
+        for (size_t _i = 1; _i < _size; ++_i) {
+            _min = _data[_i] < _min ? _data[_i] : _min;
+        }
+        return _min;
+    }
+    
+    template <typename T, typename A>
+    inline T OSReduce::max(const std::vector<T, A>& column_) throw(OSException)
+    {
+        if (column_.empty()) {
+            throw OSException("OSReduce error: max of an empty column.");
+        }
+        const T* _data = column_.data();
+        const size_t _size = column_.size();
+        T _max = _data[0];
+        for (size_t _i = 1; _i < _size; ++_i) {
+            _max = _data[_i] > _max ? _data[_i] : _max;
+        }
+        return _max;
+    }
+    
+    template <typename T, typename A, typename Predicate>
+    inline size_t OSReduce::countWhere(const std::vector<T, A>& column_, Predicate predicate_)
+    {
+        const T* _data = column_.data();
+        const size_t _size = column_.size();
+        size_t _count = 0;
+        for (size_t _i = 0; _i < _size; ++_i) {
+            _count += predicate_(_data[_i]) ? 1 : 0;
+        }
+        return _count;
+    }
+    
+    
+    
+    
+    // Functions for OSException
+    OSException::OSException() noexcept : _content("OSLite exception"), _tag(0)
+    {}
+    
+    OSException::OSException(const char* content_) noexcept : _content(content_), _tag(0)
+    {}
+    
+    OSException::OSException(const char* content_, unsigned tag_) noexcept : _content(content_), _tag(tag_)
+    {}
+    
+    OSException::~OSException() noexcept
+    {}
+    
+    const char* OSException::what() const noexcept
+    {return _content.c_str();}
+    
+    const unsigned OSException::tag() const noexcept
+    {return _tag;}
+    
+    
+    
+    
+    // Functions for OSTablePolicy
+    template <class _DerivedCLS_>
+    template <typename... Args>
+    OSTablePolicy<_DerivedCLS_>::OSTablePolicy(const std::string& tableName_, std::initializer_list<std::string> keyNamesList_, Args&... args_) throw(OSException)
+    {
+        static_assert(sizeof...(Args) > 0, "OSTablePolicy: a primary key must be bound.");
+        static_assert(!OSHasView<Args...>::value, "OSTablePolicy: views cannot be table keys.");
         
-        // Execute
-        int _result = sqlite3_exec(_connection, _sqlString.c_str(), [](void*,int,char** iptr2,char**){return ((**iptr2)=='0')-1;}, nullptr, nullptr);
-        if (_result == SQLITE_ABORT) {
-            // Exists.
-            return true;
-        } else if (_result == SQLITE_OK) {
-            // Not exists.
-            return false;
-        } else {
-            throw OSException("exists error. sqlite3_exec execution failed.", _result);
+        // Offsets of the keys from this policy subobject.
+        const ptrdiff_t _offsets[] = {(reinterpret_cast<const char*>(&args_) - reinterpret_cast<const char*>(this))...};
+        std::call_once(_registration, [&]() {
+            if (keyNamesList_.size() != sizeof...(Args)) {
+                throw OSException("OSTablePolicy error: the numbers of key names and keys differ.");
+            }
+            _tableName = tableName_;
+            _keyNameVec = keyNamesList_;
+            _keyOffsets.assign(_offsets, _offsets + sizeof...(Args));
+            _returnAssign = &OSTypeOp<0, Args...>::queryReturnAssign;
+            _paramBinding = &OSTypeOp<0, Args...>::queryParamBinding;
+            _keyBinding = &OSTypeOp<0, Args...>::queryKeyBinding;
+            _cacheTable = OSObjectCache::tableKey(tableName_.c_str());
+            _rowOps = &OSObjectRow<Args...>::operations;
+            generateSQL();
+            _hasBindings = true;
+        });
+        if (_keyOffsets.size() != sizeof...(Args) || !std::equal(_keyOffsets.begin(), _keyOffsets.end(), _offsets)) {
+            throw OSException("OSTablePolicy error: keys differ from the registered ones.");
+        }
+    }
+    
+    template <class _DerivedCLS_>
+    OSTablePolicy<_DerivedCLS_>::~OSTablePolicy()
+    {}
+    
+    template <class _DerivedCLS_>
+    inline void OSTablePolicy<_DerivedCLS_>::queryReturnAssign(sqlite3_stmt* statement_)
+    {
+        _returnAssign(reinterpret_cast<char*>(this), _keyOffsets.data(), statement_);
+    }
+    
+    template <class _DerivedCLS_>
+    inline void OSTablePolicy<_DerivedCLS_>::queryParamBinding(sqlite3_stmt* statement_) const
+    {
+        _paramBinding(reinterpret_cast<const char*>(this), _keyOffsets.data(), statement_);
+    }
+    
+    template <class _DerivedCLS_>
+    inline void OSTablePolicy<_DerivedCLS_>::queryKeyBinding(sqlite3_stmt* statement_, int index_) const
+    {
+        _keyBinding(reinterpret_cast<const char*>(this), _keyOffsets.data(), statement_, index_);
+    }
+    
+    template <class _DerivedCLS_>
+    inline std::string OSTablePolicy<_DerivedCLS_>::queryCacheKey() const
+    {
+        return _rowOps->key(reinterpret_cast<const char*>(this), _keyOffsets.data());
+    }
+    
+    template <class _DerivedCLS_>
+    inline bool OSTablePolicy<_DerivedCLS_>::queryCacheLookup(OSObjectCache& cache_, const std::string& key_)
+    {
+        return cache_.lookup(_cacheTable, key_, _rowOps, reinterpret_cast<char*>(this), _keyOffsets.data());
+    }
+    
+    template <class _DerivedCLS_>
+    inline void OSTablePolicy<_DerivedCLS_>::queryCacheStore(OSObjectCache& cache_, const std::string& key_, unsigned long long generation_) const
+    {
+        cache_.store(_cacheTable, key_, _rowOps, reinterpret_cast<const char*>(this), _keyOffsets.data(), generation_);
+    }
+    
+    template <class _DerivedCLS_>
+    void OSTablePolicy<_DerivedCLS_>::generateSQL()
+    {
+        if (_keyNameVec.empty()) {
+            return;
+        }
+        std::string _columns, _values, _assignments;
+        for (auto& _str : _keyNameVec) {
+            _columns += _str + ",";
+            _values += "?,";
+            _assignments += _str + "=?,";
+        }
+        _columns.pop_back();
+        _values.pop_back();
+        _assignments.pop_back();
+        const std::string _keyCondition = " where " + _keyNameVec[0] + "=?";
+        
+        _saveSQL = "insert into " + _tableName + "(" + _columns + ") values(" + _values + ")";
+        _existsSQL = "select count(*) from " + _tableName + _keyCondition;
+        _fillSQL = "select " + _columns + " from " + _tableName + _keyCondition;
+        _updateSQL = "update " + _tableName + " set " + _assignments + _keyCondition;
+        _deleteSQL = "delete from " + _tableName + _keyCondition;
+    }
+    
+    template <class _DerivedCLS_>
+    bool OSTablePolicy<_DerivedCLS_>::checkBindings()
+    {
+        return _hasBindings && _keyNameVec.size()>1;
+    }
+    
+    
+    
+    // Functions for OSQuery
+    OSQuery::OSQuery(const OSDatabase& database_) throw(OSException) : _connection(database_._connection), _cache(database_._statementCache), _objectCache(database_._objectCache)
+    {
+        if (_connection == nullptr) {
+            throw OSException("OSStatement ctor error: SQLite connection is not opened.");
+        }
+    }
+    
+    OSQuery::~OSQuery()
+    {
+        if (_statement != nullptr) {
+            sqlite3_finalize(_statement);
+            _statement = nullptr;
+        }
+    }
+    
+    template <typename Table>
+    typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type OSQuery::save(Table& table_) throw(OSException)
+    {
+        const std::string& _sqlString = table_._saveSQL;
+        OSObjectCache* _objects = nullptr;
+        std::string _key;
+        try {
+            // Check the acceptance of table binding
+            if (!table_.checkBindings()) {
+                throw OSException("save error: table binding is not acceptable.");
+            }
+            
+            // The own change of the row does not invalidate the whole table.
+            if (_objectCache) {
+                _key = table_.queryCacheKey();
+                _objects = _objectCache.get();
+                _objects->beginWrite(table_._cacheTable);
+            }
+            
+            // The SQL is generated once per table type; the prepared
+            // statement comes from the connection cache.
+            int _result = _cache.acquire(_sqlString, &_statement);
+            if (_result != SQLITE_OK) {
+                throw OSException("save error: Cannot prepare the sqlite3_stmt.", _result);
+            }
+            
+            // Parameter binding.
+            table_.queryParamBinding(_statement);
+            
+            // Execute
+            _result = _cache.step(_statement);
+            if (_result != SQLITE_DONE) {
+                throw OSException("save error. Execute SQLString failed.", _result);
+            }
+            if (_objects != nullptr) {
+                _objects->endWrite(table_._cacheTable, _key);
+            }
+            
+            _cache.release(_sqlString, _statement);
+            _statement = nullptr;
+        } catch (const OSException&) {
+            if (_objects != nullptr) {
+                _objects->endWrite(table_._cacheTable, _key);
+            }
+            _cache.release(_sqlString, _statement);
+            _statement = nullptr;
+            throw;
+        }
+    }
+    
+    template <typename Table>
+    typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type OSQuery::exists(Table& table_) throw(OSException)
+    {
+        const std::string& _sqlString = table_._existsSQL;
+        try {
+            // Check the acceptance of table binding
+            if (!table_.checkBindings()) {
+                throw OSException("exists error: table binding is not acceptable.");
+            }
+            
+            // A cached row exists.
+            if (_objectCache && _objectCache->contains(table_._cacheTable, table_.queryCacheKey(), table_._rowOps)) {
+                return true;
+            }
+            
+            // Process select count operations to check if the data exists
+            int _result = _cache.acquire(_sqlString, &_statement);
+            if (_result != SQLITE_OK) {
+                throw OSException("exists error: Cannot prepare the sqlite3_stmt.", _result);
+            }
+            
+            // Primary key binding.
+            table_.queryKeyBinding(_statement, 1);
+            
+            // Execute
+            _result = _cache.step(_statement);
+            if (_result != SQLITE_ROW) {
+                throw OSException("exists error. Execute SQLString failed.", _result);
+            }
+            bool _exists = sqlite3_column_int(_statement, 0) != 0;
+            
+            _cache.release(_sqlString, _statement);
+            _statement = nullptr;
+            return _exists;
+        } catch (const OSException&) {
+            _cache.release(_sqlString, _statement);
+            _statement = nullptr;
+            throw;
         }
     }
     
     template <typename Table>
     typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type OSQuery::fill(Table& table_) throw(OSException)
     {
+        const std::string& _sqlString = table_._fillSQL;
+        OSObjectCache* _objects = _objectCache.get();
+        std::string _key;
+        unsigned long long _generation = 0;
         try {
             // Check the acceptance of table binding
             if (!table_.checkBindings()) {
                 throw OSException("fill error: table binding is not acceptable.");
             }
             
-            // Construct SQL string
-            std::stringstream _sqlStream;
-            _sqlStream << "select ";
-            for (auto& _str : table_._keyNameVec) {
-                _sqlStream << _str << ",";
+            // From the object cache if the row is there.
+            if (_objects != nullptr) {
+                _key = table_.queryCacheKey();
+                if (table_.queryCacheLookup(*_objects, _key)) {
+                    return true;
+                }
+                _generation = _objects->generation();
             }
-            std::string _sqlString = _sqlStream.str();
-            _sqlString[_sqlString.size()-1] = ' ';
-            _sqlStream.str("");
-            _sqlStream << "from " << table_._tableName << " where " << table_._keyNameVec[0] << "='";
-            table_._keyReference->queryPrimaryKey(_sqlStream);
-            _sqlStream << "'";
-            _sqlString += _sqlStream.str();
             
-            // Prepare statement first.
-            int _result = sqlite3_prepare_v2(_connection, _sqlString.c_str(), (int)_sqlString.size(), &_statement, nullptr);
+            // Take the prepared statement from the connection cache first.
+            int _result = _cache.acquire(_sqlString, &_statement);
             if (_result != SQLITE_OK) {
                 throw OSException("fill error: Cannot prepare the sqlite3_stmt.", _result);
             }
             
+            // Primary key binding.
+            table_.queryKeyBinding(_statement, 1);
+            
             // Get value.
             int _colCount = sqlite3_column_count(_statement);
             assert(_colCount == table_._keyNameVec.size());
-            _result = sqlite3_step(_statement);
+            _result = _cache.step(_statement);
             if (_result == SQLITE_DONE) {
-                sqlite3_finalize(_statement);
+                _cache.release(_sqlString, _statement);
                 _statement = nullptr;
                 return false;
             }
             if (_result != SQLITE_ROW) {
                 throw OSException("fill error: step error", _result);
             }
-            table_._keyReference->queryReturnAssign(_statement);
-            sqlite3_finalize(_statement);
+            table_.queryReturnAssign(_statement);
+            // Rows read in a transaction may still be rolled back.
+            if (_objects != nullptr && sqlite3_get_autocommit(_connection)) {
+                table_.queryCacheStore(*_objects, _key, _generation);
+            }
+            _cache.release(_sqlString, _statement);
             _statement = nullptr;
             return true;
             
         } catch (const OSException&) {
-            sqlite3_finalize(_statement);
+            _cache.release(_sqlString, _statement);
             _statement = nullptr;
             throw;
         }
@@ -579,60 +1070,76 @@ namespace OSQLite {
     template <typename Table>
     typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type OSQuery::update(Table& table_) throw(OSException)
     {
+        const std::string& _sqlString = table_._updateSQL;
+        OSObjectCache* _objects = nullptr;
+        std::string _key;
         try {
             // Check the acceptance of table binding
             if (!table_.checkBindings()) {
                 throw OSException("update error: table binding is not acceptable.");
             }
             
-            // Construct the SQL string and fill in data
-            std::stringstream _sqlStream;
-            _sqlStream << "update  " << table_._tableName << " set ";
-            for (auto& _str : table_._keyNameVec) {
-                _sqlStream << _str << "=?,";
+            // The own change of the row does not invalidate the whole table.
+            if (_objectCache) {
+                _key = table_.queryCacheKey();
+                _objects = _objectCache.get();
+                _objects->beginWrite(table_._cacheTable);
             }
-            std::string _sqlString = _sqlStream.str();
-            _sqlString[_sqlString.size()-1] = ' ';
-            _sqlStream.str("");
-            _sqlStream << " where " << table_._keyNameVec[0] << "='";
-            table_._keyReference->queryPrimaryKey(_sqlStream);
-            _sqlStream << "'";
-            _sqlString += _sqlStream.str();
             
-            // Prepare statement first.
-            int _result = sqlite3_prepare_v2(_connection, _sqlString.c_str(), (int)_sqlString.size(), &_statement, nullptr);
+            // Take the prepared statement from the connection cache first.
+            int _result = _cache.acquire(_sqlString, &_statement);
             if (_result != SQLITE_OK) {
                 throw OSException("update error: Cannot prepare the sqlite3_stmt.", _result);
             }
             
-            // Parameter binding.
-            table_._keyReference->queryParamBinding(_statement);
+            // Parameter binding. The primary key of the where clause follows
+            // all the assigned keys.
+            table_.queryParamBinding(_statement);
+            table_.queryKeyBinding(_statement, (int)table_._keyNameVec.size()+1);
             
             // Execute
-            _result = sqlite3_step(_statement);
+            _result = _cache.step(_statement);
             if (_result != SQLITE_DONE) {
                 throw OSException("update error. Execute SQLString failed.", _result);
             }
+            if (_objects != nullptr) {
+                _objects->endWrite(table_._cacheTable, _key);
+            }
             
-            sqlite3_finalize(_statement);
+            _cache.release(_sqlString, _statement);
             _statement = nullptr;
         } catch(const OSException&) {
-            sqlite3_finalize(_statement);
+            if (_objects != nullptr) {
+                _objects->endWrite(table_._cacheTable, _key);
+            }
+            _cache.release(_sqlString, _statement);
             _statement = nullptr;
             throw;
         }
     }
     
     template <typename Table>
-    typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type OSQuery::saveOrUpdate(Table& table_) throw(OSException)
+    typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, bool>::type OSQuery::saveOrUpdate(Table& table_) throw(OSException)
     try {
-        // check the existance.
-        if (this->exists(table_)) {
-            // Exists. Perform update.
-            this->update(table_);
-        } else {
-            // Not exists. Perform save.
+        // Update first, and save only when no record has the primary key.
+        // Both statements are cached, and sqlite3_changes replaces exists.
+        this->update(table_);
+        if (sqlite3_changes(_connection) > 0) {
+            return false;
+        }
+        try {
             this->save(table_);
+            return true;
+        } catch (const OSException& e) {
+            // Another connection may have saved the key since the update.
+            if (e.tag() != SQLITE_CONSTRAINT) {
+                throw;
+            }
+            this->update(table_);
+            if (sqlite3_changes(_connection) == 0) {
+                throw;
+            }
+            return false;
         }
     } catch (const OSException& e) {
         std::string _oldExceptionStr(e.what());
@@ -643,34 +1150,157 @@ namespace OSQLite {
     template <typename Table>
     typename std::enable_if<std::is_base_of<OSTablePolicy<Table>, Table>::value, void>::type OSQuery::deleteObject(Table& table_) throw(OSException)
     {
-        // Check the acceptance of table binding
-        if (!table_.checkBindings()) {
-            throw OSException("update error: table binding is not acceptable.");
-        }
-        
-        // Construct the SQL string and fill in data directly
-        std::string _sqlString = "delete from " + table_._tableName + " where ";
-        _sqlString += table_._keyNameVec[0];
-        _sqlString += "='";
-        std::stringstream _sqlStream;
-        table_._keyReference->queryPrimaryKey(_sqlStream);
-        _sqlString += "'";
-        
-        // Execute
-        int _result = sqlite3_exec(_connection, _sqlString.c_str(), nullptr, nullptr, nullptr);
-        if (_result != SQLITE_OK) {
-            throw OSException("update error. sqlite3_exec execution failed.", _result);
-        }
-    }
-    
-    
-    
-    
-    // Functions for OSStatement
-    OSStatement::OSStatement(const OSDatabase& database_) throw(OSException) : _connection(database_._connection)
-    {
-        if (_connection == nullptr) {
-            throw OSException("OSStatement ctor error: SQLite connection is not opened.");
+        const std::string& _sqlString = table_._deleteSQL;
+        OSObjectCache* _objects = nullptr;
+        std::string _key;
+        try {
+            // Check the acceptance of table binding
+            if (!table_.checkBindings()) {
+                throw OSException("deleteObject error: table binding is not acceptable.");
+            }
+            
+            // The own change of the row does not invalidate the whole table.
+            if (_objectCache) {
+                _key = table_.queryCacheKey();
+                _objects = _objectCache.get();
+                _objects->beginWrite(table_._cacheTable);
+            }
+            
+            // Take the prepared statement from the connection cache first.
+            int _result = _cache.acquire(_sqlString, &_statement);
+            if (_result != SQLITE_OK) {
+                throw OSException("deleteObject error: Cannot prepare the sqlite3_stmt.", _result);
+            }
+            
+            // Primary key binding.
+            table_.queryKeyBinding(_statement, 1);
+            
+            // Execute
+            _result = _cache.step(_statement);
+            if (_result != SQLITE_DONE) {
+                throw OSException("deleteObject error. Execute SQLString failed.", _result);
+            }
+            if (_objects != nullptr) {
+                _objects->endWrite(table_._cacheTable, _key);
+            }
+            
+            _cache.release(_sqlString, _statement);
+            _statement = nullptr;
+        } catch (const OSException&) {
+            if (_objects != nullptr) {
+                _objects->endWrite(table_._cacheTable, _key);
+            }
+            _cache.release(_sqlString, _statement);
+            _statement = nullptr;
+            throw;
+        }
+    }
+    
+    
+    
+    
+    template <typename Range, typename Binding>
+    std::vector<OSBatchTiming> OSQuery::executeAll(Range& range_, size_t batchSize_, const std::string& sqlString_, const std::string& name_, Binding binding_) throw(OSException)
+    {
+        typedef OSElementTraits<typename std::decay<decltype(*std::begin(range_))>::type> _Traits;
+        std::vector<OSBatchTiming> _timings;
+        auto _iter = std::begin(range_);
+        auto _end = std::end(range_);
+        if (_iter == _end) {
+            return _timings;
+        }
+        try {
+            // Check the acceptance of table binding
+            if (!_Traits::object(*_iter).checkBindings()) {
+                throw OSException((name_ + " error: table binding is not acceptable.").c_str());
+            }
+            
+            // One prepared statement for the whole range.
+            int _result = _cache.acquire(sqlString_, &_statement);
+            if (_result != SQLITE_OK) {
+                throw OSException((name_ + " error: Cannot prepare the sqlite3_stmt.").c_str(), _result);
+            }
+            
+            while (_iter != _end) {
+                OSBatchTiming _timing;
+                auto _start = std::chrono::steady_clock::now();
+                // A savepoint starts a transaction, or nests in the caller's one.
+                _result = sqlite3_exec(_connection, "savepoint OSQueryBatch", nullptr, nullptr, nullptr);
+                if (_result != SQLITE_OK) {
+                    throw OSException((name_ + " error: Cannot begin the batch.").c_str(), _result);
+                }
+                try {
+                    for (; _iter != _end && (batchSize_ == 0 || _timing.rows < batchSize_); ++_iter) {
+                        binding_(_Traits::object(*_iter), _statement);
+                        _result = _cache.step(_statement);
+                        if (_result != SQLITE_DONE) {
+                            throw OSException((name_ + " error. Execute SQLString failed.").c_str(), _result);
+                        }
+                        sqlite3_reset(_statement);
+                        ++_timing.rows;
+                    }
+                    _result = sqlite3_exec(_connection, "release OSQueryBatch", nullptr, nullptr, nullptr);
+                    if (_result != SQLITE_OK) {
+                        throw OSException((name_ + " error: Cannot commit the batch.").c_str(), _result);
+                    }
+                } catch (const OSException&) {
+                    sqlite3_reset(_statement);
+                    sqlite3_exec(_connection, "rollback to OSQueryBatch; release OSQueryBatch", nullptr, nullptr, nullptr);
+                    throw;
+                }
+                _timing.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start);
+                _timings.push_back(_timing);
+            }
+            
+            _cache.release(sqlString_, _statement);
+            _statement = nullptr;
+            return _timings;
+        } catch (const OSException&) {
+            _cache.release(sqlString_, _statement);
+            _statement = nullptr;
+            throw;
+        }
+    }
+    
+    template <typename Range>
+    std::vector<OSBatchTiming> OSQuery::saveAll(Range& range_, size_t batchSize_) throw(OSException)
+    {
+        typedef typename OSElementTraits<typename std::decay<decltype(*std::begin(range_))>::type>::Table Table;
+        static_assert(std::is_base_of<OSTablePolicy<Table>, Table>::value, "saveAll: elements must be OSTablePolicy objects.");
+        return this->executeAll(range_, batchSize_, OSTablePolicy<Table>::_saveSQL, "saveAll", [](Table& table_, sqlite3_stmt* statement_) {
+            table_.queryParamBinding(statement_);
+        });
+    }
+    
+    template <typename Range>
+    std::vector<OSBatchTiming> OSQuery::updateAll(Range& range_, size_t batchSize_) throw(OSException)
+    {
+        typedef typename OSElementTraits<typename std::decay<decltype(*std::begin(range_))>::type>::Table Table;
+        static_assert(std::is_base_of<OSTablePolicy<Table>, Table>::value, "updateAll: elements must be OSTablePolicy objects.");
+        return this->executeAll(range_, batchSize_, OSTablePolicy<Table>::_updateSQL, "updateAll", [](Table& table_, sqlite3_stmt* statement_) {
+            table_.queryParamBinding(statement_);
+            table_.queryKeyBinding(statement_, (int)table_._keyNameVec.size()+1);
+        });
+    }
+    
+    template <typename Range>
+    std::vector<OSBatchTiming> OSQuery::deleteAll(Range& range_, size_t batchSize_) throw(OSException)
+    {
+        typedef typename OSElementTraits<typename std::decay<decltype(*std::begin(range_))>::type>::Table Table;
+        static_assert(std::is_base_of<OSTablePolicy<Table>, Table>::value, "deleteAll: elements must be OSTablePolicy objects.");
+        return this->executeAll(range_, batchSize_, OSTablePolicy<Table>::_deleteSQL, "deleteAll", [](Table& table_, sqlite3_stmt* statement_) {
+            table_.queryKeyBinding(statement_, 1);
+        });
+    }
+    
+    
+    
+    
+    // Functions for OSStatement
+    OSStatement::OSStatement(const OSDatabase& database_) throw(OSException) : _connection(database_._connection), _cache(database_._statementCache)
+    {
+        if (_connection == nullptr) {
+            throw OSException("OSStatement ctor error: SQLite connection is not opened.");
         }
     }
     
@@ -683,63 +1313,97 @@ namespace OSQLite {
     }
     
     template <typename... Args>
-    void OSStatement::execute(const std::string& sqlString_, Args&... args_) throw(OSException)
+    void OSStatement::execute(const std::string& sqlString_, const Args&... args_) throw(OSException)
     try {
-        // Prepare statement first.
-        int _result = sqlite3_prepare_v2(_connection, sqlString_.c_str(), (int)sqlString_.length(), &_statement, nullptr);
+        // Take a prepared statement from the connection cache first.
+        int _result = _cache.acquire(sqlString_, &_statement);
         if (_result != SQLITE_OK) {
             throw OSException("execute error: Cannot prepare the sqlite3_stmt.", _result);
         }
         
-        // Parameter binding.
-        OSTypeOp<0, Args...>::statementParamBinding(_statement, args_...);
+        // Parameter binding. The arguments outlive the steps, and release
+        // clears the bindings, so nothing is copied.
+        OSTypeOp<0, Args...>::statementParamBinding(_statement, SQLITE_STATIC, args_...);
         
         // Execute
-        _result = sqlite3_step(_statement);
+        _result = _cache.step(_statement);
         if (_result != SQLITE_DONE) {
             throw OSException("execute error. Execute SQLString failed.", _result);
         }
         
-        sqlite3_finalize(_statement);
+        _cache.release(sqlString_, _statement);
         _statement = nullptr;
         
     } catch (const OSException&) {
-        sqlite3_finalize(_statement);
+        _cache.release(sqlString_, _statement);
         _statement = nullptr;
         throw;
     }
     
     
     void OSStatement::execute(const std::string& sqlString_) throw(OSException)
-    {
-        int _result = sqlite3_exec(_connection, sqlString_.c_str(), nullptr, nullptr, nullptr);
+    try {
+        // One statement through the cache, so that metrics and the slow-query
+        // log see it too.
+        int _result = _cache.acquire(sqlString_, &_statement, true);
         if (_result != SQLITE_OK) {
-            throw OSException("execute error. sqlite3_exec execution failed.", _result);
+            throw OSException("execute error: Cannot prepare the sqlite3_stmt.", _result);
+        }
+        if (_statement == nullptr) {
+            _result = sqlite3_exec(_connection, sqlString_.c_str(), nullptr, nullptr, nullptr);
+            if (_result != SQLITE_OK) {
+                throw OSException("execute error. sqlite3_exec execution failed.", _result);
+            }
+            return;
+        }
+        
+        // Rows, e.g. of a pragma, are skipped as sqlite3_exec does.
+        while ((_result = _cache.step(_statement)) == SQLITE_ROW) {
+        }
+        if (_result != SQLITE_DONE) {
+            throw OSException("execute error. Execute SQLString failed.", _result);
         }
+        
+        _cache.release(sqlString_, _statement);
+        _statement = nullptr;
+        
+    } catch (const OSException&) {
+        _cache.release(sqlString_, _statement);
+        _statement = nullptr;
+        throw;
     }
     
     template <typename... Returns, typename... Args>
-    std::vector<std::tuple<Returns...>> OSStatement::executeRows(const std::string& sqlString_, Args&... args_) throw (OSException)
+    std::vector<std::tuple<Returns...>> OSStatement::executeRows(const std::string& sqlString_, const Args&... args_) throw (OSException)
+    {
+        std::vector<std::tuple<Returns...>> _returnVec;
+        this->executeRows(_returnVec, sqlString_, args_...);
+        return _returnVec;
+    }
+    
+    template <typename... Returns, typename Allocator, typename... Args>
+    void OSStatement::executeRows(std::vector<std::tuple<Returns...>, Allocator>& rows_, const std::string& sqlString_, const Args&... args_) throw (OSException)
     try {
-        // Prepare statement first.
-        int _result = sqlite3_prepare_v2(_connection, sqlString_.c_str(), (int)sqlString_.length(), &_statement, nullptr);
+        static_assert(!OSHasView<Returns...>::value, "executeRows: views are only valid in executeCursor.");
+        // Take a prepared statement from the connection cache first.
+        int _result = _cache.acquire(sqlString_, &_statement);
         if (_result != SQLITE_OK) {
             throw OSException("execute error: Cannot prepare the sqlite3_stmt.", _result);
         }
         
-        // Parameter binding.
-        OSTypeOp<0, Args...>::statementParamBinding(_statement, args_...);
+        // Parameter binding. The arguments outlive the steps, and release
+        // clears the bindings, so nothing is copied.
+        OSTypeOp<0, Args...>::statementParamBinding(_statement, SQLITE_STATIC, args_...);
         
-        // Create a vector and a tuple instance. Get values, and assign them to
-        // the tuple. Finally push the tuple back to the vector.
-        std::vector<std::tuple<Returns...>> _returnVec;
+        // Create a tuple instance. Get values, and assign them to the tuple.
+        // Finally push the tuple back to the vector.
         std::tuple<Returns...> _tuple;
         
         // Get value
         int _colCount = sqlite3_column_count(_statement);
         assert(_colCount == std::tuple_size<decltype(_tuple)>::value);
         while (true) {
-            _result = sqlite3_step(_statement);
+            _result = _cache.step(_statement);
             if (_result == SQLITE_DONE) {
                 break;
             }
@@ -748,46 +1412,169 @@ namespace OSQLite {
             }
             
             OSTypeOp<0, Returns...>::statementReturnAssign(_tuple, _statement);
-            _returnVec.push_back(_tuple);
+            rows_.push_back(_tuple);
         }
         
-        sqlite3_finalize(_statement);
+        _cache.release(sqlString_, _statement);
         _statement = nullptr;
-        return _returnVec;
         
     } catch (const OSException&) {
-        sqlite3_finalize(_statement);
+        _cache.release(sqlString_, _statement);
+        _statement = nullptr;
+        throw;
+    }
+    
+    
+    template <typename... Returns, typename... Args>
+    OSCursor<Returns...> OSStatement::executeCursor(const std::string& sqlString_, const Args&... args_) throw (OSException)
+    {
+        // The cursor owns its statement, not this OSStatement.
+        sqlite3_stmt* _cursorStatement = nullptr;
+        int _result = _cache.acquire(sqlString_, &_cursorStatement);
+        if (_result != SQLITE_OK) {
+            throw OSException("executeCursor error: Cannot prepare the sqlite3_stmt.", _result);
+        }
+        
+        try {
+            // Parameter binding.
+            // The arguments may be gone when the cursor steps: copy them.
+            OSTypeOp<0, Args...>::statementParamBinding(_cursorStatement, SQLITE_TRANSIENT, args_...);
+        } catch (const OSException&) {
+            _cache.release(sqlString_, _cursorStatement);
+            throw;
+        }
+        
+        int _colCount = sqlite3_column_count(_cursorStatement);
+        assert(_colCount == sizeof...(Returns));
+        return OSCursor<Returns...>(_cache, sqlString_, _cursorStatement);
+    }
+    
+    
+    template <typename... Columns, typename... Args>
+    std::tuple<OSColumn<Columns>...> OSStatement::executeColumns(const std::string& sqlString_, const Args&... args_) throw (OSException)
+    try {
+        static_assert(!OSHasView<Columns...>::value, "executeColumns: views are only valid in executeCursor.");
+        // Take a prepared statement from the connection cache first.
+        int _result = _cache.acquire(sqlString_, &_statement);
+        if (_result != SQLITE_OK) {
+            throw OSException("executeColumns error: Cannot prepare the sqlite3_stmt.", _result);
+        }
+        
+        // Parameter binding. The arguments outlive the steps, and release
+        // clears the bindings, so nothing is copied.
+        OSTypeOp<0, Args...>::statementParamBinding(_statement, SQLITE_STATIC, args_...);
+        
+        // Append every row to the column vectors.
+        std::tuple<OSColumn<Columns>...> _columns;
+        int _colCount = sqlite3_column_count(_statement);
+        assert(_colCount == sizeof...(Columns));
+        while ((_result = _cache.step(_statement)) == SQLITE_ROW) {
+            OSColumnsOp<0, Columns...>::append(_columns, _statement);
+        }
+        if (_result != SQLITE_DONE) {
+            throw OSException("executeColumns error: step error", _result);
+        }
+        
+        _cache.release(sqlString_, _statement);
+        _statement = nullptr;
+        return _columns;
+        
+    } catch (const OSException&) {
+        _cache.release(sqlString_, _statement);
         _statement = nullptr;
         throw;
     }
     
     
     template <typename R, typename... Args>
-    R OSStatement::executeScalar(const std::string& sqlString_, Args&... args_) throw(OSException)
+    R OSStatement::executeScalar(const std::string& sqlString_, const Args&... args_) throw(OSException)
     try {
-        // Prepare statement first.
-        int _result = sqlite3_prepare_v2(_connection, sqlString_.c_str(), (int)sqlString_.length(), &_statement, nullptr);
+        static_assert(!OSHasView<R>::value, "executeScalar: views are only valid in executeCursor.");
+        // Take a prepared statement from the connection cache first.
+        int _result = _cache.acquire(sqlString_, &_statement);
         if (_result != SQLITE_OK) {
             throw OSException("executeScalar error: Cannot prepare the sqlite3_stmt.", _result);
         }
         
-        // Parameter binding.
-        OSTypeOp<0, Args...>::statementParamBinding(_statement, args_...);
+        // Parameter binding. The arguments outlive the steps, and release
+        // clears the bindings, so nothing is copied.
+        OSTypeOp<0, Args...>::statementParamBinding(_statement, SQLITE_STATIC, args_...);
         
         // Execute
-        _result = sqlite3_step(_statement);
+        _result = _cache.step(_statement);
         if (_result != SQLITE_ROW) {
             throw OSException("executeScalar error. Execute SQLString failed.", _result);
         }
         std::tuple<R> _tuple;
         OSTypeOp<0, R>::statementReturnAssign(_tuple, _statement);
         
-        sqlite3_finalize(_statement);
+        _cache.release(sqlString_, _statement);
         _statement = nullptr;
         return std::get<0>(_tuple);
         
     } catch (const OSException&) {
-        sqlite3_finalize(_statement);
+        _cache.release(sqlString_, _statement);
+        _statement = nullptr;
+        throw;
+    }
+    
+    template <typename... Args>
+    OSBatchTiming OSStatement::executeMany(const std::string& sqlString_, const std::vector<std::tuple<Args...>>& rows_, bool transaction_) throw(OSException)
+    {
+        return this->executeMany(sqlString_, rows_.begin(), rows_.end(), transaction_);
+    }
+    
+    template <typename InputIterator>
+    OSBatchTiming OSStatement::executeMany(const std::string& sqlString_, InputIterator first_, InputIterator last_, bool transaction_) throw(OSException)
+    try {
+        OSBatchTiming _timing;
+        auto _start = std::chrono::steady_clock::now();
+        // One prepared statement for all the rows.
+        int _result = _cache.acquire(sqlString_, &_statement);
+        if (_result != SQLITE_OK) {
+            throw OSException("executeMany error: Cannot prepare the sqlite3_stmt.", _result);
+        }
+        
+        // A savepoint starts a transaction, or nests in the caller's one.
+        if (transaction_) {
+            _result = sqlite3_exec(_connection, "savepoint OSStatementBatch", nullptr, nullptr, nullptr);
+            if (_result != SQLITE_OK) {
+                throw OSException("executeMany error: Cannot begin the batch.", _result);
+            }
+        }
+        try {
+            for (; first_ != last_; ++first_) {
+                // The row lives until the statement is reset, so nothing is copied.
+                const auto& _row = *first_;
+                OSTupleBind(_statement, _row, SQLITE_STATIC);
+                _result = _cache.step(_statement);
+                if (_result != SQLITE_DONE) {
+                    throw OSException("executeMany error. Execute SQLString failed.", _result);
+                }
+                sqlite3_reset(_statement);
+                ++_timing.rows;
+            }
+            if (transaction_) {
+                _result = sqlite3_exec(_connection, "release OSStatementBatch", nullptr, nullptr, nullptr);
+                if (_result != SQLITE_OK) {
+                    throw OSException("executeMany error: Cannot commit the batch.", _result);
+                }
+            }
+        } catch (const OSException&) {
+            sqlite3_reset(_statement);
+            if (transaction_) {
+                sqlite3_exec(_connection, "rollback to OSStatementBatch; release OSStatementBatch", nullptr, nullptr, nullptr);
+            }
+            throw;
+        }
+        
+        _cache.release(sqlString_, _statement);
+        _statement = nullptr;
+        _timing.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start);
+        return _timing;
+        
+    } catch (const OSException&) {
+        _cache.release(sqlString_, _statement);
         _statement = nullptr;
         throw;
     }
@@ -822,29 +1609,2463 @@ namespace OSQLite {
     
     
     
-    // Functions for OSDatabase
-    OSDatabase::OSDatabase(const std::string& filePath_) throw(OSException)
+    // Functions for OSCursor
+    template <typename... Returns>
+    OSCursor<Returns...>::OSCursor(OSStatementCache& cache_, const std::string& sqlString_, sqlite3_stmt* statement_) noexcept : _cache(&cache_), _sqlString(sqlString_), _statement(statement_)
+    {}
+    
+    template <typename... Returns>
+    OSCursor<Returns...>::OSCursor(OSCursor&& other_) noexcept : _cache(other_._cache), _sqlString(std::move(other_._sqlString)), _statement(other_._statement), _row(std::move(other_._row)), _started(other_._started)
     {
-        _connection = nullptr;
-        if (filePath_.length()==0)
-            throw OSException("Invalid SQLite database file path");
-        int _result = sqlite3_open(filePath_.c_str(), &_connection);
+        other_._statement = nullptr;
+    }
+    
+    template <typename... Returns>
+    OSCursor<Returns...>::~OSCursor()
+    {
+        this->finish();
+    }
+    
+    template <typename... Returns>
+    inline void OSCursor<Returns...>::finish() noexcept
+    {
+        if (_statement != nullptr) {
+            _cache->release(_sqlString, _statement);
+            _statement = nullptr;
+        }
+    }
+    
+    template <typename... Returns>
+    inline bool OSCursor<Returns...>::next() throw(OSException)
+    {
+        _started = true;
+        if (_statement == nullptr) {
+            return false;
+        }
+        int _result = _cache->step(_statement);
+        if (_result == SQLITE_ROW) {
+            OSTypeOp<0, Returns...>::statementReturnAssign(_row, _statement);
+            return true;
+        }
+        // Done or failed. Either way the statement is not needed any more.
+        this->finish();
+        if (_result != SQLITE_DONE) {
+            throw OSException("executeCursor error: step error", _result);
+        }
+        return false;
+    }
+    
+    template <typename... Returns>
+    inline const std::tuple<Returns...>& OSCursor<Returns...>::row() const noexcept
+    {return _row;}
+    
+    template <typename... Returns>
+    inline typename OSCursor<Returns...>::iterator OSCursor<Returns...>::begin() throw(OSException)
+    {
+        if (!_started && !this->next()) {
+            return this->end();
+        }
+        return iterator(_statement == nullptr ? nullptr : this);
+    }
+    
+    template <typename... Returns>
+    inline typename OSCursor<Returns...>::iterator OSCursor<Returns...>::end() noexcept
+    {return iterator(nullptr);}
+    
+    template <typename... Returns>
+    OSCursor<Returns...>::iterator::iterator(OSCursor* cursor_) noexcept : _cursor(cursor_)
+    {}
+    
+    template <typename... Returns>
+    inline const std::tuple<Returns...>& OSCursor<Returns...>::iterator::operator*() const noexcept
+    {return _cursor->_row;}
+    
+    template <typename... Returns>
+    inline const std::tuple<Returns...>* OSCursor<Returns...>::iterator::operator->() const noexcept
+    {return &_cursor->_row;}
+    
+    template <typename... Returns>
+    inline typename OSCursor<Returns...>::iterator& OSCursor<Returns...>::iterator::operator++() throw(OSException)
+    {
+        if (!_cursor->next()) {
+            _cursor = nullptr;
+        }
+        return *this;
+    }
+    
+    template <typename... Returns>
+    inline bool OSCursor<Returns...>::iterator::operator==(const iterator& other_) const noexcept
+    {return _cursor == other_._cursor;}
+    
+    template <typename... Returns>
+    inline bool OSCursor<Returns...>::iterator::operator!=(const iterator& other_) const noexcept
+    {return _cursor != other_._cursor;}
+    
+    
+    
+    
+    // Functions for OSBlobHandle, OSBlobReader, OSBlobWriter
+    OSBlobHandle::OSBlobHandle(const OSDatabase& database_, const std::string& table_, const std::string& column_, sqlite3_int64 rowid_, const std::string& schema_, bool write_) throw(OSException)
+    {
+        if (database_._connection == nullptr)
+            throw OSException("OSBlobHandle ctor error: SQLite connection is not opened.");
+        int _result = sqlite3_blob_open(database_._connection, schema_.c_str(), table_.c_str(), column_.c_str(), rowid_, write_ ? 1 : 0, &_blob);
         if (_result != SQLITE_OK) {
-            sqlite3_close(_connection);
-            _connection = nullptr;
-            throw OSException("Cannot open SQLite database file.", _result);
+            // The handle may be set even on failure.
+            sqlite3_blob_close(_blob);
+            _blob = nullptr;
+            throw OSException("OSBlobHandle ctor error: Cannot open the blob.", _result);
         }
+        _size = (size_t)sqlite3_blob_bytes(_blob);
     }
     
-    OSDatabase::~OSDatabase()
+    OSBlobHandle::~OSBlobHandle()
     {
-        if (_connection != nullptr) {
-            int _result = sqlite3_close(_connection);
-            if (_result != SQLITE_OK) {
-                _connection = nullptr;
-                throw OSException("Cannot close SQLite database", _result);
-            }
+        // Closing a handle does not fail unless a write was left undone,
+        // which has been reported by write.
+        sqlite3_blob_close(_blob);
+    }
+    
+    inline size_t OSBlobHandle::size() const noexcept
+    {return _size;}
+    
+    inline size_t OSBlobHandle::position() const noexcept
+    {return _position;}
+    
+    inline size_t OSBlobHandle::remaining() const noexcept
+    {return _size - _position;}
+    
+    inline void OSBlobHandle::seek(size_t position_) throw(OSException)
+    {
+        if (position_ > _size)
+            throw OSException("seek error: position after the end of the blob.", SQLITE_RANGE);
+        _position = position_;
+    }
+    
+    inline void OSBlobHandle::reopen(sqlite3_int64 rowid_) throw(OSException)
+    {
+        int _result = sqlite3_blob_reopen(_blob, rowid_);
+        if (_result != SQLITE_OK) {
+            // The handle is aborted now, so only reading or writing would tell.
+            _size = 0;
+            _position = 0;
+            throw OSException("reopen error: Cannot move to the row.", _result);
+        }
+        _size = (size_t)sqlite3_blob_bytes(_blob);
+        _position = 0;
+    }
+    
+    OSBlobReader::OSBlobReader(const OSDatabase& database_, const std::string& table_, const std::string& column_, sqlite3_int64 rowid_, const std::string& schema_) throw(OSException) : OSBlobHandle(database_, table_, column_, rowid_, schema_, false)
+    {}
+    
+    inline size_t OSBlobReader::read(void* buffer_, size_t size_) throw(OSException)
+    {
+        size_t _bytes = std::min(size_, _size - _position);
+        if (_bytes == 0)
+            return 0;
+        int _result = sqlite3_blob_read(_blob, buffer_, (int)_bytes, (int)_position);
+        if (_result != SQLITE_OK)
+            throw OSException("read error: Cannot read the blob.", _result);
+        _position += _bytes;
+        return _bytes;
+    }
+    
+    OSBlobWriter::OSBlobWriter(const OSDatabase& database_, const std::string& table_, const std::string& column_, sqlite3_int64 rowid_, const std::string& schema_) throw(OSException) : OSBlobHandle(database_, table_, column_, rowid_, schema_, true)
+    {}
+    
+    inline void OSBlobWriter::write(const void* data_, size_t size_) throw(OSException)
+    {
+        if (size_ > _size - _position)
+            throw OSException("write error: data after the end of the blob, which cannot grow.", SQLITE_RANGE);
+        if (size_ == 0)
+            return;
+        int _result = sqlite3_blob_write(_blob, data_, (int)size_, (int)_position);
+        if (_result != SQLITE_OK)
+            throw OSException("write error: Cannot write the blob.", _result);
+        _position += size_;
+    }
+    
+    inline void OSBlobWriter::write(const OSBlobView& data_) throw(OSException)
+    {
+        this->write(data_.data, data_.size);
+    }
+    
+    
+    
+    
+    // Functions for OSLatencyHistogram
+    OSLatencyHistogram::OSLatencyHistogram() noexcept : _count(0), _total(0)
+    {
+        for (auto& _bucket : _buckets)
+            _bucket.store(0, std::memory_order_relaxed);
+    }
+    
+    inline size_t OSLatencyHistogram::bucket(unsigned long long nanoseconds_) noexcept
+    {
+        if (nanoseconds_ < 4)
+            return (size_t)nanoseconds_;
+        // Index of the highest bit, then the two bits below it.
+        size_t _exponent = 0;
+        for (size_t _shift = 32; _shift > 0; _shift /= 2) {
+            if (nanoseconds_ >> (_exponent + _shift))
+                _exponent += _shift;
+        }
+        return 4 * (_exponent - 1) + (size_t)((nanoseconds_ >> (_exponent - 2)) & 3);
+    }
+    
+    inline unsigned long long OSLatencyHistogram::upperBound(size_t bucket_) noexcept
+    {
+        if (bucket_ < 4)
+            return bucket_;
+        size_t _exponent = bucket_ / 4 + 1;
+        unsigned long long _lower = (unsigned long long)(4 + bucket_ % 4) << (_exponent - 2);
+        return _lower + (1ULL << (_exponent - 2)) - 1;
+    }
+    
+    inline void OSLatencyHistogram::record(std::chrono::nanoseconds latency_) noexcept
+    {
+        unsigned long long _nanoseconds = latency_.count() > 0 ? (unsigned long long)latency_.count() : 0;
+        _buckets[bucket(_nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _total.fetch_add(_nanoseconds, std::memory_order_relaxed);
+    }
+    
+    inline void OSLatencyHistogram::reset() noexcept
+    {
+        for (auto& _bucket : _buckets)
+            _bucket.store(0, std::memory_order_relaxed);
+        _count.store(0, std::memory_order_relaxed);
+        _total.store(0, std::memory_order_relaxed);
+    }
+    
+    inline unsigned long long OSLatencyHistogram::count() const noexcept
+    {return _count.load(std::memory_order_relaxed);}
+    
+    inline std::chrono::nanoseconds OSLatencyHistogram::mean() const noexcept
+    {
+        unsigned long long _count = this->count();
+        return std::chrono::nanoseconds(_count == 0 ? 0 : (long long)(_total.load(std::memory_order_relaxed) / _count));
+    }
+    
+    inline std::chrono::nanoseconds OSLatencyHistogram::percentile(double quantile_) const noexcept
+    {
+        unsigned long long _count = this->count();
+        if (_count == 0)
+            return std::chrono::nanoseconds(0);
+        // Rank of the quantile, 1-based: the smallest with rank/count >= quantile.
+        unsigned long long _rank = (unsigned long long)std::ceil(quantile_ * _count);
+        if (_rank < 1)
+            _rank = 1;
+        if (_rank > _count)
+            _rank = _count;
+        unsigned long long _seen = 0;
+        for (size_t _i = 0; _i < _bucketCount; ++_i) {
+            _seen += _buckets[_i].load(std::memory_order_relaxed);
+            if (_seen >= _rank)
+                return std::chrono::nanoseconds((long long)upperBound(_i));
+        }
+        return std::chrono::nanoseconds((long long)upperBound(_bucketCount - 1));
+    }
+    
+    
+    
+    
+    // Functions for OSMetrics
+    OSMetrics::OSMetrics()
+    {
+        _checkouts.reserve(4);
+    }
+    
+    inline std::string OSMetrics::fingerprint(const std::string& sqlString_)
+    {
+        std::string _result;
+        _result.reserve(sqlString_.size());
+        bool _space = false;
+        for (size_t _i = 0; _i < sqlString_.size(); ++_i) {
+            char _char = sqlString_[_i];
+            if (isspace((unsigned char)_char)) {
+                _space = !_result.empty();
+                continue;
+            }
+            if (_space) {
+                _result += ' ';
+                _space = false;
+            }
+            bool _identifier = !_result.empty() && (isalnum((unsigned char)_result.back()) || _result.back() == '_');
+            if (_char == '\'') {
+                // String literal, '' escapes a quote.
+                for (++_i; _i < sqlString_.size(); ++_i) {
+                    if (sqlString_[_i] == '\'') {
+                        if (_i + 1 < sqlString_.size() && sqlString_[_i + 1] == '\'')
+                            ++_i;
+                        else
+                            break;
+                    }
+                }
+                _result += '?';
+            } else if (isdigit((unsigned char)_char) && !_identifier) {
+                while (_i + 1 < sqlString_.size() && (isalnum((unsigned char)sqlString_[_i + 1]) || sqlString_[_i + 1] == '.'))
+                    ++_i;
+                _result += '?';
+            } else {
+                _result += _char;
+            }
+        }
+        return _result;
+    }
+    
+    inline OSMetrics::Checkout* OSMetrics::find(sqlite3_stmt* statement_) noexcept
+    {
+        // The latest checkout is the likely one.
+        for (size_t _i = _checkouts.size(); _i > 0; --_i) {
+            if (_checkouts[_i - 1].statement == statement_)
+                return &_checkouts[_i - 1];
+        }
+        return nullptr;
+    }
+    
+    inline void OSMetrics::checkout(const std::string& sqlString_, sqlite3_stmt* statement_, bool prepared_, Counters*& counters_)
+    {
+        if (counters_ == nullptr) {
+            std::string _fingerprint = fingerprint(sqlString_);
+            std::lock_guard<std::mutex> _lock(_mutex);
+            std::unique_ptr<Counters>& _entry = _fingerprints[_fingerprint];
+            if (!_entry)
+                _entry.reset(new Counters);
+            counters_ = _entry.get();
+        }
+        Counters* _counters = counters_;
+        if (prepared_) {
+            _counters->prepares.fetch_add(1, std::memory_order_relaxed);
+            _total.prepares.fetch_add(1, std::memory_order_relaxed);
+        }
+        Checkout _checkout = {statement_, _counters, std::chrono::steady_clock::now()};
+        _checkouts.push_back(_checkout);
+    }
+    
+    inline void OSMetrics::row(sqlite3_stmt* statement_) noexcept
+    {
+        Checkout* _checkout = this->find(statement_);
+        if (_checkout != nullptr) {
+            _checkout->counters->rows.fetch_add(1, std::memory_order_relaxed);
+            _total.rows.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+    inline OSMetrics::Counters* OSMetrics::checkin(sqlite3_stmt* statement_) noexcept
+    {
+        Checkout* _checkout = this->find(statement_);
+        if (_checkout == nullptr)
+            return nullptr;
+        auto _latency = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _checkout->start);
+        // Read and reset, so the next execution starts from zero.
+        unsigned long long _vmSteps = sqlite3_stmt_status(statement_, SQLITE_STMTSTATUS_VM_STEP, 1);
+        unsigned long long _fullScanSteps = sqlite3_stmt_status(statement_, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+        unsigned long long _sorts = sqlite3_stmt_status(statement_, SQLITE_STMTSTATUS_SORT, 1);
+        unsigned long long _autoIndexes = sqlite3_stmt_status(statement_, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+        Counters* _targets[2] = {_checkout->counters, &_total};
+        for (Counters* _counters : _targets) {
+            _counters->executions.fetch_add(1, std::memory_order_relaxed);
+            _counters->vmSteps.fetch_add(_vmSteps, std::memory_order_relaxed);
+            _counters->fullScanSteps.fetch_add(_fullScanSteps, std::memory_order_relaxed);
+            _counters->sorts.fetch_add(_sorts, std::memory_order_relaxed);
+            _counters->autoIndexes.fetch_add(_autoIndexes, std::memory_order_relaxed);
+            _counters->latency.record(_latency);
+        }
+        Counters* _counters = _checkout->counters;
+        *_checkout = _checkouts.back();
+        _checkouts.pop_back();
+        return _counters;
+    }
+    
+    inline void OSMetrics::fill(OSStatementMetrics& metrics_, const Counters& counters_)
+    {
+        metrics_.executions = counters_.executions.load(std::memory_order_relaxed);
+        metrics_.prepares = counters_.prepares.load(std::memory_order_relaxed);
+        metrics_.rows = counters_.rows.load(std::memory_order_relaxed);
+        metrics_.vmSteps = counters_.vmSteps.load(std::memory_order_relaxed);
+        metrics_.fullScanSteps = counters_.fullScanSteps.load(std::memory_order_relaxed);
+        metrics_.sorts = counters_.sorts.load(std::memory_order_relaxed);
+        metrics_.autoIndexes = counters_.autoIndexes.load(std::memory_order_relaxed);
+        metrics_.mean = counters_.latency.mean();
+        metrics_.p50 = counters_.latency.percentile(0.5);
+        metrics_.p99 = counters_.latency.percentile(0.99);
+        metrics_.p999 = counters_.latency.percentile(0.999);
+    }
+    
+    inline void OSMetrics::snapshot(OSMetricsSnapshot& snapshot_) const
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        snapshot_.statements.clear();
+        for (auto& _entry : _fingerprints) {
+            OSStatementMetrics _metrics;
+            _metrics.fingerprint = _entry.first;
+            fill(_metrics, *_entry.second);
+            snapshot_.statements.push_back(_metrics);
+        }
+        fill(snapshot_.total, _total);
+    }
+    
+    
+    
+    
+    // Functions for OSSlowQueryLog
+    OSSlowQueryLog::OSSlowQueryLog(sqlite3* connection_, std::chrono::nanoseconds threshold_, size_t capacity_, std::function<void(const OSSlowQuery&)> callback_) : _connection(connection_), _threshold(threshold_), _capacity(capacity_ > 0 ? capacity_ : 1), _callback(std::move(callback_))
+    {
+        _checkouts.reserve(4);
+        sqlite3_trace(_connection, &OSSlowQueryLog::trace, this);
+    }
+    
+    OSSlowQueryLog::~OSSlowQueryLog()
+    {
+        sqlite3_trace(_connection, nullptr, nullptr);
+    }
+    
+    inline void OSSlowQueryLog::trace(void* log_, const char* expandedSQL_)
+    {
+        OSSlowQueryLog* _log = static_cast<OSSlowQueryLog*>(log_);
+        // Statements run by sqlite3_exec or nested in triggers are not ours.
+        if (_log->_stepping != nullptr && expandedSQL_ != nullptr) {
+            _log->_stepping->expandedSQL = expandedSQL_;
+        }
+    }
+    
+    inline OSSlowQueryLog::Checkout* OSSlowQueryLog::find(sqlite3_stmt* statement_) noexcept
+    {
+        for (size_t _i = _checkouts.size(); _i > 0; --_i) {
+            if (_checkouts[_i - 1].statement == statement_)
+                return &_checkouts[_i - 1];
+        }
+        return nullptr;
+    }
+    
+    inline void OSSlowQueryLog::checkout(sqlite3_stmt* statement_)
+    {
+        Checkout _checkout = {statement_, std::chrono::steady_clock::now(), std::string()};
+        _checkouts.push_back(std::move(_checkout));
+    }
+    
+    inline void OSSlowQueryLog::stepping(sqlite3_stmt* statement_) noexcept
+    {
+        _stepping = statement_ != nullptr ? this->find(statement_) : nullptr;
+    }
+    
+    inline void OSSlowQueryLog::explain(OSSlowQuery& entry_) noexcept
+    {
+        sqlite3_stmt* _statement = nullptr;
+        std::string _sqlString = "explain query plan " + entry_.sqlString;
+        if (sqlite3_prepare_v2(_connection, _sqlString.c_str(), (int)_sqlString.length(), &_statement, nullptr) != SQLITE_OK) {
+            sqlite3_finalize(_statement);
+            return;
+        }
+        // Columns: selectid, order, from, detail.
+        while (sqlite3_step(_statement) == SQLITE_ROW) {
+            const char* _detail = (const char*)sqlite3_column_text(_statement, 3);
+            if (_detail == nullptr)
+                continue;
+            std::string _line(_detail);
+            if (_line.compare(0, 5, "SCAN ") == 0 && _line.find(" USING ") == std::string::npos)
+                entry_.fullScan = true;
+            if (_line.find("TEMP B-TREE") != std::string::npos)
+                entry_.tempBTree = true;
+            entry_.queryPlan.push_back(std::move(_line));
+        }
+        sqlite3_finalize(_statement);
+    }
+    
+    inline void OSSlowQueryLog::checkin(const std::string& sqlString_, sqlite3_stmt* statement_) noexcept
+    {
+        Checkout* _checkout = this->find(statement_);
+        if (_checkout == nullptr)
+            return;
+        auto _elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _checkout->start);
+        if (_elapsed >= _threshold) {
+            try {
+                OSSlowQuery _entry;
+                _entry.sqlString = sqlString_;
+                _entry.expandedSQL = _checkout->expandedSQL.empty() ? sqlString_ : _checkout->expandedSQL;
+                _entry.elapsed = _elapsed;
+                this->explain(_entry);
+                if (_callback)
+                    _callback(_entry);
+                std::lock_guard<std::mutex> _lock(_mutex);
+                _entries.push_back(std::move(_entry));
+                if (_entries.size() > _capacity)
+                    _entries.pop_front();
+            } catch (...) {
+                // Out of memory or a failing callback: the entry is dropped.
+            }
+        }
+        *_checkout = std::move(_checkouts.back());
+        _checkouts.pop_back();
+    }
+    
+    inline std::vector<OSSlowQuery> OSSlowQueryLog::entries() const
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        return std::vector<OSSlowQuery>(_entries.begin(), _entries.end());
+    }
+    
+    inline void OSSlowQueryLog::clear() noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        _entries.clear();
+    }
+    
+    
+    
+    
+    // Functions for OSStatementCache
+    OSStatementCache::OSStatementCache(sqlite3* const& connection_, size_t capacity_) : _connection(connection_), _capacity(capacity_)
+    {}
+    
+    OSStatementCache::~OSStatementCache()
+    {
+        this->clear();
+    }
+    
+    inline int OSStatementCache::acquire(const std::string& sqlString_, sqlite3_stmt** statement_, bool single_) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        bool _prepared = true;
+        OSMetrics::Counters* _counters = nullptr;
+        OSMetrics::Counters** _countersOf = &_counters;
+        auto _iter = _index.find(sqlString_);
+        if (_iter != _index.end() && !_iter->second->checkedOut) {
+            // Hit. Check the statement out; it comes back in release().
+            ++_hits;
+            _prepared = false;
+            *statement_ = _iter->second->statement;
+            _countersOf = &_iter->second->counters;
+            _iter->second->checkedOut = true;
+            _checkedOut.splice(_checkedOut.begin(), _entries, _iter->second);
+        } else {
+            // A miss, or the cached statement is out: prepare another one.
+            ++_misses;
+            *statement_ = nullptr;
+            const char* _tail = nullptr;
+            int _result = sqlite3_prepare_v2(_connection, sqlString_.c_str(), (int)sqlString_.length(), statement_, &_tail);
+            if (_result != SQLITE_OK) {
+                return _result;
+            }
+            if (single_) {
+                while (_tail != nullptr && isspace((unsigned char)*_tail))
+                    ++_tail;
+                // Cached under the whole SQL, it would run the first statement only.
+                if (*statement_ == nullptr || (_tail != nullptr && *_tail != '\0')) {
+                    sqlite3_finalize(*statement_);
+                    *statement_ = nullptr;
+                    return SQLITE_OK;
+                }
+            }
+        }
+        try {
+            if (_metrics)
+                _metrics->checkout(sqlString_, *statement_, _prepared, *_countersOf);
+            if (_slowQueryLog)
+                _slowQueryLog->checkout(*statement_);
+        } catch (...) {
+            // Out of memory: the execution is not recorded.
+        }
+        return SQLITE_OK;
+    }
+    
+    inline void OSStatementCache::release(const std::string& sqlString_, sqlite3_stmt* statement_) noexcept
+    {
+        if (statement_ == nullptr) {
+            return;
+        }
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        OSMetrics::Counters* _counters = nullptr;
+        if (_metrics) {
+            _counters = _metrics->checkin(statement_);
+        }
+        if (_slowQueryLog) {
+            _slowQueryLog->checkin(sqlString_, statement_);
+        }
+        auto _iter = _index.find(sqlString_);
+        bool _cached = _iter != _index.end() && _iter->second->statement == statement_;
+        if (_capacity == 0 || (_iter != _index.end() && !_cached)) {
+            if (_cached) {
+                this->erase(_checkedOut, _iter->second);
+            } else {
+                sqlite3_finalize(statement_);
+            }
+            return;
+        }
+        // The result of reset repeats the last step error, which has been
+        // reported already.
+        sqlite3_reset(statement_);
+        sqlite3_clear_bindings(statement_);
+        if (_cached) {
+            _iter->second->checkedOut = false;
+            _entries.splice(_entries.begin(), _checkedOut, _iter->second);
+            this->evict(_capacity);
+            return;
+        }
+        try {
+            _entries.push_front(_Entry{sqlString_, statement_, false, _counters});
+            try {
+                _index[sqlString_] = _entries.begin();
+            } catch (...) {
+                _entries.pop_front();
+                throw;
+            }
+        } catch (const std::bad_alloc&) {
+            // Out of memory: not cached.
+            sqlite3_finalize(statement_);
+            return;
+        }
+        this->evict(_capacity);
+    }
+    
+    inline int OSStatementCache::step(sqlite3_stmt* statement_) noexcept
+    {
+        // _slowQueryLog and _metrics only change while no statement is out.
+        if (_slowQueryLog) {
+            // Guarded through the step, so that the trace lands in the
+            // checkout of this statement. SQLite serializes the steps of a
+            // connection anyway.
+            std::lock_guard<std::recursive_mutex> _lock(_mutex);
+            _slowQueryLog->stepping(statement_);
+            int _result = sqlite3_step(statement_);
+            _slowQueryLog->stepping(nullptr);
+            if (_metrics && _result == SQLITE_ROW) {
+                _metrics->row(statement_);
+            }
+            return _result;
+        }
+        int _result = sqlite3_step(statement_);
+        if (_metrics && _result == SQLITE_ROW) {
+            std::lock_guard<std::recursive_mutex> _lock(_mutex);
+            _metrics->row(statement_);
+        }
+        return _result;
+    }
+    
+    inline void OSStatementCache::evict(size_t size_)
+    {
+        while (_entries.size() > size_) {
+            this->erase(_entries, std::prev(_entries.end()));
+        }
+    }
+    
+    inline void OSStatementCache::erase(std::list<_Entry>& list_, std::list<_Entry>::iterator entry_)
+    {
+        sqlite3_finalize(entry_->statement);
+        _index.erase(entry_->sqlString);
+        list_.erase(entry_);
+    }
+    
+    inline void OSStatementCache::clear() noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        this->evict(0);
+    }
+    
+    inline void OSStatementCache::setCapacity(size_t capacity_) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        _capacity = capacity_;
+        this->evict(_capacity);
+    }
+    
+    inline size_t OSStatementCache::capacity() const noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        return _capacity;
+    }
+    
+    inline size_t OSStatementCache::size() const noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        return _entries.size();
+    }
+    
+    inline unsigned long long OSStatementCache::hits() const noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        return _hits;
+    }
+    
+    inline unsigned long long OSStatementCache::misses() const noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        return _misses;
+    }
+    
+    inline void OSStatementCache::enableMetrics(bool enable_) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        _metrics.reset(enable_ ? new (std::nothrow) OSMetrics : nullptr);
+        // The counters of the entries were in the old metrics.
+        for (_Entry& _entry : _entries)
+            _entry.counters = nullptr;
+        for (_Entry& _entry : _checkedOut)
+            _entry.counters = nullptr;
+    }
+    
+    inline const OSMetrics* OSStatementCache::metrics() const noexcept
+    {return _metrics.get();}
+    
+    inline void OSStatementCache::setSlowQueryLog(OSSlowQueryLog* slowQueryLog_) noexcept
+    {
+        std::lock_guard<std::recursive_mutex> _lock(_mutex);
+        _slowQueryLog.reset(slowQueryLog_);
+    }
+    
+    inline const OSSlowQueryLog* OSStatementCache::slowQueryLog() const noexcept
+    {return _slowQueryLog.get();}
+    
+    
+    
+    
+    // Functions for OSObjectCache
+    inline double OSObjectCacheStatistics::hitRate() const noexcept
+    {
+        unsigned long long _lookups = hits + misses;
+        return _lookups == 0 ? 0.0 : (double)hits / (double)_lookups;
+    }
+    
+    OSObjectCache::OSObjectCache(size_t memoryBudget_)
+    {
+        _statistics.memoryBudget = memoryBudget_;
+    }
+    
+    OSObjectCache::~OSObjectCache()
+    {
+        for (auto& _entry : _entries)
+            _entry.ops->destroy(_entry.row);
+    }
+    
+    inline std::string OSObjectCache::tableKey(const char* table_)
+    {
+        std::string _table(table_);
+        for (auto& _char : _table)
+            _char = (char)tolower((unsigned char)_char);
+        return _table;
+    }
+    
+    inline std::list<OSObjectCache::_Entry>::iterator OSObjectCache::find(const std::string& table_, const std::string& key_, const OSObjectRowOps* ops_) noexcept
+    {
+        auto _table = _tables.find(table_);
+        if (_table == _tables.end())
+            return _entries.end();
+        auto _iter = _table->second.find(key_);
+        // Another type registered for the same table has its own rows.
+        if (_iter == _table->second.end() || _iter->second->ops != ops_)
+            return _entries.end();
+        return _iter->second;
+    }
+    
+    inline void OSObjectCache::erase(std::list<_Entry>::iterator entry_) noexcept
+    {
+        auto _table = _tables.find(entry_->table);
+        _table->second.erase(entry_->key);
+        if (_table->second.empty())
+            _tables.erase(_table);
+        entry_->ops->destroy(entry_->row);
+        _statistics.bytes -= entry_->bytes;
+        _entries.erase(entry_);
+    }
+    
+    inline void OSObjectCache::eraseTable(const std::string& table_) noexcept
+    {
+        auto _table = _tables.find(table_);
+        if (_table == _tables.end())
+            return;
+        for (auto& _key : _table->second) {
+            _key.second->ops->destroy(_key.second->row);
+            _statistics.bytes -= _key.second->bytes;
+            _entries.erase(_key.second);
+            ++_statistics.invalidations;
+        }
+        _tables.erase(_table);
+    }
+    
+    inline void OSObjectCache::evict() noexcept
+    {
+        while (_statistics.bytes > _statistics.memoryBudget && !_entries.empty()) {
+            this->erase(std::prev(_entries.end()));
+            ++_statistics.evictions;
+        }
+    }
+    
+    inline bool OSObjectCache::lookup(const std::string& table_, const std::string& key_, const OSObjectRowOps* ops_, char* object_, const ptrdiff_t* offsets_)
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        auto _iter = this->find(table_, key_, ops_);
+        if (_iter == _entries.end()) {
+            ++_statistics.misses;
+            return false;
+        }
+        _entries.splice(_entries.begin(), _entries, _iter);
+        ops_->assign(object_, offsets_, _iter->row);
+        ++_statistics.hits;
+        return true;
+    }
+    
+    inline bool OSObjectCache::contains(const std::string& table_, const std::string& key_, const OSObjectRowOps* ops_) noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        auto _iter = this->find(table_, key_, ops_);
+        if (_iter == _entries.end()) {
+            ++_statistics.misses;
+            return false;
+        }
+        _entries.splice(_entries.begin(), _entries, _iter);
+        ++_statistics.hits;
+        return true;
+    }
+    
+    inline unsigned long long OSObjectCache::generation() const noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        return _generation;
+    }
+    
+    inline void OSObjectCache::store(const std::string& table_, const std::string& key_, const OSObjectRowOps* ops_, const char* object_, const ptrdiff_t* offsets_, unsigned long long generation_) noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        if (generation_ != _generation || _statistics.memoryBudget == 0)
+            return;
+        try {
+            void* _row = ops_->create(object_, offsets_);
+            std::unique_ptr<void, void (*)(void*)> _owner(_row, ops_->destroy);
+            size_t _bytes = sizeof(_Entry) + table_.size() + key_.size() + ops_->bytes(_row);
+            auto& _table = _tables[table_];
+            auto _key = _table.find(key_);
+            if (_key != _table.end()) {
+                // Read again by another thread since; keep the newest copy.
+                _key->second->ops->destroy(_key->second->row);
+                _statistics.bytes -= _key->second->bytes;
+                _key->second->ops = ops_;
+                _key->second->row = _owner.release();
+                _key->second->bytes = _bytes;
+                _entries.splice(_entries.begin(), _entries, _key->second);
+            } else {
+                _entries.push_front(_Entry{table_, key_, ops_, _row, _bytes});
+                try {
+                    _table.emplace(key_, _entries.begin());
+                } catch (...) {
+                    _entries.pop_front();
+                    throw;
+                }
+                _owner.release();
+            }
+            _statistics.bytes += _bytes;
+        } catch (const std::bad_alloc&) {
+            // Out of memory: the row is just not cached.
+            return;
+        }
+        this->evict();
+    }
+    
+    inline void OSObjectCache::beginWrite(const std::string& table_) noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        _writer = std::this_thread::get_id();
+        _writerTable = table_;
+        _writerChanged = false;
+    }
+    
+    inline void OSObjectCache::endWrite(const std::string& table_, const std::string& key_) noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        if (_writer == std::this_thread::get_id())
+            _writer = std::thread::id();
+        auto _table = _tables.find(table_);
+        if (_table != _tables.end()) {
+            auto _key = _table->second.find(key_);
+            if (_key != _table->second.end()) {
+                this->erase(_key->second);
+                ++_statistics.invalidations;
+            }
+        }
+        // A row read during the write is not stored.
+        ++_generation;
+    }
+    
+    inline void OSObjectCache::changed(const char* table_) noexcept
+    {
+        if (table_ == nullptr) {
+            this->invalidate();
+            return;
+        }
+        std::string _table;
+        try {
+            _table = OSObjectCache::tableKey(table_);
+        } catch (...) {
+            this->invalidate();
+            return;
+        }
+        std::lock_guard<std::mutex> _lock(_mutex);
+        // The first change of an OSQuery write is its own row, dropped by
+        // endWrite; any other is a trigger or another statement.
+        if (_writer == std::this_thread::get_id() && !_writerChanged && _writerTable == _table) {
+            _writerChanged = true;
+            return;
+        }
+        this->eraseTable(_table);
+        ++_generation;
+    }
+    
+    inline void OSObjectCache::invalidate() noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        _statistics.invalidations += _entries.size();
+        for (auto& _entry : _entries)
+            _entry.ops->destroy(_entry.row);
+        _entries.clear();
+        _tables.clear();
+        _statistics.bytes = 0;
+        ++_generation;
+    }
+    
+    inline void OSObjectCache::setMemoryBudget(size_t memoryBudget_) noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        _statistics.memoryBudget = memoryBudget_;
+        this->evict();
+    }
+    
+    inline OSObjectCacheStatistics OSObjectCache::statistics() const noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        OSObjectCacheStatistics _statistics = this->_statistics;
+        _statistics.entries = _entries.size();
+        return _statistics;
+    }
+    
+    
+    
+    
+    // Functions for OSDatabaseOptions
+    inline OSDatabaseOptions OSDatabaseOptions::oltp() noexcept
+    {
+        OSDatabaseOptions _options;
+        _options.journalMode = "WAL";
+        _options.synchronous = 1;
+        _options.cacheSize = -16384;
+        _options.tempStore = 2;
+        _options.queryOnly = 0;
+        _options.busyTimeout = 5000;
+        return _options;
+    }
+    
+    inline OSDatabaseOptions OSDatabaseOptions::bulkLoad() noexcept
+    {
+        OSDatabaseOptions _options;
+        _options.journalMode = "MEMORY";
+        _options.synchronous = 0;
+        _options.cacheSize = -262144;
+        _options.tempStore = 2;
+        _options.queryOnly = 0;
+        return _options;
+    }
+    
+    inline OSDatabaseOptions OSDatabaseOptions::readOnlyAnalytics() noexcept
+    {
+        OSDatabaseOptions _options;
+        _options.openFlags = SQLITE_OPEN_READONLY;
+        _options.cacheSize = -65536;
+        _options.mmapSize = 268435456;
+        _options.tempStore = 2;
+        _options.queryOnly = 1;
+        _options.busyTimeout = 5000;
+        return _options;
+    }
+    
+    inline OSDatabaseOptions OSDatabaseOptions::inMemoryMirror(std::chrono::milliseconds flushInterval_) noexcept
+    {
+        OSDatabaseOptions _options;
+        _options.tempStore = 2;
+        _options.mirror = true;
+        _options.flushInterval = flushInterval_;
+        return _options;
+    }
+    
+    
+    
+    
+    // Functions for OSDatabase
+    OSDatabase::OSDatabase(const std::string& filePath_) throw(OSException) : OSDatabase(filePath_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)
+    {}
+    
+    OSDatabase::OSDatabase(const std::string& filePath_, int openFlags_) throw(OSException) : _statementCache(_connection, OSQLITE_STATEMENT_CACHE_CAPACITY)
+    {
+        _connection = nullptr;
+        if (filePath_.length()==0)
+            throw OSException("Invalid SQLite database file path");
+        OSMemoryPool::connectionOpened();
+        int _result = sqlite3_open_v2(filePath_.c_str(), &_connection, openFlags_, nullptr);
+        if (_result != SQLITE_OK) {
+            sqlite3_close(_connection);
+            OSMemoryPool::connectionClosed();
+            _connection = nullptr;
+            throw OSException("Cannot open SQLite database file.", _result);
+        }
+    }
+    
+    OSDatabase::OSDatabase(const std::string& filePath_, const OSDatabaseOptions& options_) throw(OSException) : OSDatabase(options_.mirror ? std::string(":memory:") : filePath_, options_.mirror ? SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE : options_.openFlags)
+    {
+        if (options_.mirror) {
+            if (filePath_.length()==0)
+                throw OSException("Invalid SQLite database file path");
+            _mirror.reset(new OSMirror(_connection, filePath_, options_.openFlags, options_.flushInterval));
+        }
+        this->applyOptions(options_);
+    }
+    
+    OSDatabase::~OSDatabase()
+    {
+        // The last flush of a mirror reads the connection.
+        _mirror.reset();
+        // Cached statements must be finalized, and the trace of the slow-query
+        // log removed, before the connection is closed.
+        _statementCache.clear();
+        _statementCache.setSlowQueryLog(nullptr);
+        if (_connection != nullptr) {
+            int _result = sqlite3_close(_connection);
+            if (_result != SQLITE_OK) {
+                _connection = nullptr;
+                throw OSException("Cannot close SQLite database", _result);
+            }
+            OSMemoryPool::connectionClosed();
+        }
+    }
+    
+    inline OSStatementCache& OSDatabase::statementCache() const noexcept
+    {return _statementCache;}
+    
+    inline sqlite3_int64 OSDatabase::lastInsertRowid() const noexcept
+    {return sqlite3_last_insert_rowid(_connection);}
+    
+    inline void OSDatabase::enableMetrics(bool enable_) noexcept
+    {
+        _statementCache.enableMetrics(enable_);
+    }
+    
+    inline bool OSDatabase::metricsEnabled() const noexcept
+    {return _statementCache.metrics() != nullptr;}
+    
+    inline OSMetricsSnapshot OSDatabase::metrics() const
+    {
+        OSMetricsSnapshot _snapshot;
+        if (_statementCache.metrics() != nullptr) {
+            _statementCache.metrics()->snapshot(_snapshot);
+        }
+        _snapshot.statementCacheHits = _statementCache.hits();
+        _snapshot.statementCacheMisses = _statementCache.misses();
+        int _highwater = 0;
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_CACHE_HIT, &_snapshot.pageCacheHits, &_highwater, 0);
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_CACHE_MISS, &_snapshot.pageCacheMisses, &_highwater, 0);
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_CACHE_WRITE, &_snapshot.pageCacheWrites, &_highwater, 0);
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_CACHE_USED, &_snapshot.pageCacheMemory, &_highwater, 0);
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_SCHEMA_USED, &_snapshot.schemaMemory, &_highwater, 0);
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_STMT_USED, &_snapshot.statementMemory, &_highwater, 0);
+        sqlite3_db_status(_connection, SQLITE_DBSTATUS_LOOKASIDE_USED, &_snapshot.lookasideUsed, &_highwater, 0);
+        return _snapshot;
+    }
+    
+    inline void OSDatabase::enableSlowQueryLog(std::chrono::microseconds threshold_, size_t capacity_, std::function<void(const OSSlowQuery&)> callback_)
+    {
+        // The old log unregisters its trace before the new one registers.
+        _statementCache.setSlowQueryLog(nullptr);
+        _statementCache.setSlowQueryLog(new OSSlowQueryLog(_connection, threshold_, capacity_, std::move(callback_)));
+    }
+    
+    inline void OSDatabase::disableSlowQueryLog() noexcept
+    {
+        _statementCache.setSlowQueryLog(nullptr);
+    }
+    
+    inline std::vector<OSSlowQuery> OSDatabase::slowQueries() const
+    {
+        if (_statementCache.slowQueryLog() == nullptr)
+            return std::vector<OSSlowQuery>();
+        return _statementCache.slowQueryLog()->entries();
+    }
+    
+    inline void OSDatabase::applyOptions(const OSDatabaseOptions& options_) throw(OSException)
+    {
+        // page_size must come before journal_mode, it cannot change in WAL.
+        std::ostringstream _pragmas;
+        if (options_.pageSize > 0)
+            _pragmas << "pragma page_size=" << options_.pageSize << ";";
+        if (!options_.journalMode.empty())
+            _pragmas << "pragma journal_mode=" << options_.journalMode << ";";
+        if (options_.synchronous >= 0)
+            _pragmas << "pragma synchronous=" << options_.synchronous << ";";
+        if (options_.cacheSize != 0)
+            _pragmas << "pragma cache_size=" << options_.cacheSize << ";";
+        if (options_.mmapSize >= 0)
+            _pragmas << "pragma mmap_size=" << options_.mmapSize << ";";
+        if (options_.tempStore >= 0)
+            _pragmas << "pragma temp_store=" << options_.tempStore << ";";
+        if (options_.queryOnly >= 0)
+            _pragmas << "pragma query_only=" << options_.queryOnly << ";";
+        
+        char* _errorMessage = nullptr;
+        int _result = sqlite3_exec(_connection, _pragmas.str().c_str(), nullptr, nullptr, &_errorMessage);
+        if (_result != SQLITE_OK) {
+            std::string _exceptionStr = "applyOptions error: ";
+            if (_errorMessage != nullptr) {
+                _exceptionStr += _errorMessage;
+                sqlite3_free(_errorMessage);
+            }
+            throw OSException(_exceptionStr.c_str(), _result);
+        }
+        if (options_.busyTimeout >= 0)
+            sqlite3_busy_timeout(_connection, options_.busyTimeout);
+    }
+    
+    inline std::unique_ptr<OSBackup> OSDatabase::backupTo(const std::string& filePath_, int pagesPerStep_, std::chrono::milliseconds sleep_, std::function<void(const OSBackupProgress&)> progress_) throw(OSException)
+    {return std::unique_ptr<OSBackup>(new OSBackup(*this, filePath_, false, pagesPerStep_, sleep_, std::move(progress_)));}
+    
+    inline std::unique_ptr<OSBackup> OSDatabase::restoreFrom(const std::string& filePath_, int pagesPerStep_, std::chrono::milliseconds sleep_, std::function<void(const OSBackupProgress&)> progress_) throw(OSException)
+    {
+        // The update hook does not see the pages replaced.
+        this->invalidateObjectCache();
+        return std::unique_ptr<OSBackup>(new OSBackup(*this, filePath_, true, pagesPerStep_, sleep_, std::move(progress_)));
+    }
+    
+    inline void OSDatabase::flush() throw(OSException)
+    {
+        if (_mirror)
+            _mirror->flush();
+    }
+    
+    inline bool OSDatabase::isMirror() const noexcept
+    {return (bool)_mirror;}
+    
+    inline size_t OSDatabase::addUpdateListener(std::function<void(int, const char*, const char*, sqlite3_int64)> listener_)
+    {
+        // Installed outside _updateMutex: the hook takes it while SQLite holds
+        // the connection mutex.
+        sqlite3_update_hook(_connection, &OSDatabase::updateHook, this);
+        std::lock_guard<std::mutex> _lock(_updateMutex);
+        _updateListeners.push_back(std::make_pair(++_lastUpdateListener, std::move(listener_)));
+        return _lastUpdateListener;
+    }
+    
+    inline void OSDatabase::removeUpdateListener(size_t id_) noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_updateMutex);
+        for (auto _iter = _updateListeners.begin(); _iter != _updateListeners.end(); ++_iter) {
+            if (_iter->first == id_) {
+                _updateListeners.erase(_iter);
+                return;
+            }
+        }
+    }
+    
+    inline void OSDatabase::updateHook(void* database_, int operation_, const char* databaseName_, const char* table_, sqlite3_int64 rowid_) noexcept
+    {
+        OSDatabase* _database = static_cast<OSDatabase*>(database_);
+        std::lock_guard<std::mutex> _lock(_database->_updateMutex);
+        for (auto& _listener : _database->_updateListeners)
+            _listener.second(operation_, databaseName_, table_, rowid_);
+    }
+    
+    inline int OSDatabase::authorize(void* database_, int action_, const char* argument1_, const char*, const char*, const char*) noexcept
+    {
+        OSDatabase* _database = static_cast<OSDatabase*>(database_);
+        switch (action_) {
+            case SQLITE_DELETE:
+                // SQLite passes the same pointer as to the DROP; a stale one
+                // is only compared, never dereferenced.
+                if (argument1_ != nullptr && argument1_ == _database->_droppedTable) {
+                    _database->_droppedTable = nullptr;
+                    break;
+                }
+                // SQLITE_IGNORE turns off the truncate optimization, which
+                // deletes all the rows without calling the update hook. For
+                // a DROP it would skip the drop.
+                if (argument1_ != nullptr && sqlite3_strnicmp(argument1_, "sqlite_", 7) != 0)
+                    return SQLITE_IGNORE;
+                break;
+            case SQLITE_DROP_TABLE:
+            case SQLITE_DROP_TEMP_TABLE:
+                _database->_droppedTable = argument1_;
+                if (_database->_objectCache)
+                    _database->_objectCache->invalidate();
+                break;
+            case SQLITE_DROP_VIEW:
+            case SQLITE_DROP_TEMP_VIEW:
+            case SQLITE_DROP_VTABLE:
+                _database->_droppedTable = argument1_;
+                break;
+            case SQLITE_ALTER_TABLE:
+                if (_database->_objectCache)
+                    _database->_objectCache->invalidate();
+                break;
+            default:
+                break;
+        }
+        return SQLITE_OK;
+    }
+    
+    inline void OSDatabase::enableObjectCache(size_t memoryBudget_)
+    {
+        if (_objectCache) {
+            _objectCache->setMemoryBudget(memoryBudget_);
+            return;
+        }
+        std::unique_ptr<OSObjectCache> _cache(new OSObjectCache(memoryBudget_));
+        OSObjectCache* _objects = _cache.get();
+        _objectCacheListener = this->addUpdateListener([_objects](int, const char*, const char* table_, sqlite3_int64) {
+            _objects->changed(table_);
+        });
+        sqlite3_set_authorizer(_connection, &OSDatabase::authorize, this);
+        _objectCache = std::move(_cache);
+    }
+    
+    inline void OSDatabase::disableObjectCache() noexcept
+    {
+        if (!_objectCache)
+            return;
+        sqlite3_set_authorizer(_connection, nullptr, nullptr);
+        this->removeUpdateListener(_objectCacheListener);
+        _objectCache.reset();
+    }
+    
+    inline void OSDatabase::invalidateObjectCache() noexcept
+    {
+        if (_objectCache)
+            _objectCache->invalidate();
+    }
+    
+    inline OSObjectCacheStatistics OSDatabase::objectCacheStatistics() const noexcept
+    {return _objectCache ? _objectCache->statistics() : OSObjectCacheStatistics();}
+    
+    
+    
+    
+    // Functions for OSBackup
+    inline double OSBackupProgress::fraction() const noexcept
+    {return pageCount > 0 ? (double)(pageCount - remaining) / pageCount : 0;}
+    
+    OSBackup::OSBackup(OSDatabase& database_, const std::string& filePath_, bool restore_, int pagesPerStep_, std::chrono::milliseconds sleep_, std::function<void(const OSBackupProgress&)> progress_) throw(OSException) : _pagesPerStep(pagesPerStep_ == 0 ? 1 : pagesPerStep_), _sleep(sleep_), _progress(std::move(progress_)), _finished(false), _remaining(0), _pageCount(0)
+    {
+        if (filePath_.length() == 0)
+            throw OSException("OSBackup error: Invalid SQLite database file path.");
+        OSMemoryPool::connectionOpened();
+        int _result = sqlite3_open_v2(filePath_.c_str(), &_file, restore_ ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+        if (_result != SQLITE_OK) {
+            sqlite3_close(_file);
+            OSMemoryPool::connectionClosed();
+            throw OSException("OSBackup error: Cannot open SQLite database file.", _result);
+        }
+        sqlite3* _destination = restore_ ? database_._connection : _file;
+        _backup = sqlite3_backup_init(_destination, "main", restore_ ? _file : database_._connection, "main");
+        if (_backup == nullptr) {
+            // The error is left on the destination connection.
+            std::string _exceptionStr = std::string("OSBackup error: ") + sqlite3_errmsg(_destination);
+            _result = sqlite3_errcode(_destination);
+            sqlite3_close(_file);
+            OSMemoryPool::connectionClosed();
+            throw OSException(_exceptionStr.c_str(), _result);
+        }
+        try {
+            _thread = std::thread(&OSBackup::run, this);
+        } catch (const std::system_error&) {
+            sqlite3_backup_finish(_backup);
+            sqlite3_close(_file);
+            OSMemoryPool::connectionClosed();
+            throw OSException("OSBackup error: Cannot start the backup thread.");
+        }
+    }
+    
+    OSBackup::~OSBackup()
+    {
+        this->cancel();
+        if (_thread.joinable())
+            _thread.join();
+    }
+    
+    inline void OSBackup::run() noexcept
+    {
+        int _step = SQLITE_OK;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> _lock(_mutex);
+                if (_cancelled)
+                    break;
+            }
+            _step = sqlite3_backup_step(_backup, _pagesPerStep);
+            _remaining = sqlite3_backup_remaining(_backup);
+            _pageCount = sqlite3_backup_pagecount(_backup);
+            if (_step != SQLITE_OK && _step != SQLITE_DONE && _step != SQLITE_BUSY && _step != SQLITE_LOCKED)
+                break;
+            if (_progress) {
+                try {
+                    _progress(this->progress());
+                } catch (...) {
+                    _step = SQLITE_ABORT;
+                    break;
+                }
+            }
+            if (_step == SQLITE_DONE)
+                break;
+            // Let the writers in, or wait for them.
+            std::unique_lock<std::mutex> _lock(_mutex);
+            _cancel.wait_for(_lock, _sleep, [this]() {return _cancelled;});
+        }
+        // An unfinished backup is rolled back on the destination.
+        int _finish = sqlite3_backup_finish(_backup);
+        _backup = nullptr;
+        sqlite3_close(_file);
+        OSMemoryPool::connectionClosed();
+        _file = nullptr;
+        if (_step == SQLITE_DONE) {
+            _result = _finish;
+            _completed = _finish == SQLITE_OK;
+        } else if (_step != SQLITE_OK && _step != SQLITE_BUSY && _step != SQLITE_LOCKED) {
+            _result = _step;
+        }
+        _finished = true;
+    }
+    
+    inline bool OSBackup::wait() throw(OSException)
+    {
+        if (_thread.joinable())
+            _thread.join();
+        if (_result != SQLITE_OK)
+            throw OSException((std::string("OSBackup error: ") + sqlite3_errstr(_result)).c_str(), _result);
+        return _completed;
+    }
+    
+    inline void OSBackup::cancel() noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        _cancelled = true;
+        _cancel.notify_all();
+    }
+    
+    inline bool OSBackup::finished() const noexcept
+    {return _finished;}
+    
+    inline OSBackupProgress OSBackup::progress() const noexcept
+    {
+        OSBackupProgress _progress;
+        _progress.remaining = _remaining;
+        _progress.pageCount = _pageCount;
+        return _progress;
+    }
+    
+    
+    
+    
+    // Functions for OSMirror
+    OSMirror::OSMirror(sqlite3* memory_, const std::string& filePath_, int openFlags_, std::chrono::milliseconds flushInterval_) throw(OSException) : _memory(memory_), _flushInterval(flushInterval_), _readOnly((openFlags_ & SQLITE_OPEN_READWRITE) == 0), _commits(0)
+    {
+        OSMemoryPool::connectionOpened();
+        int _result = sqlite3_open_v2(filePath_.c_str(), &_file, openFlags_, nullptr);
+        if (_result != SQLITE_OK) {
+            sqlite3_close(_file);
+            OSMemoryPool::connectionClosed();
+            throw OSException("OSMirror error: Cannot open SQLite database file.", _result);
+        }
+        sqlite3_busy_timeout(_file, 5000);
+        
+        // An in-memory destination cannot change its page size while copying.
+        sqlite3_stmt* _statement = nullptr;
+        _result = sqlite3_prepare_v2(_file, "pragma page_size", -1, &_statement, nullptr);
+        if (_result == SQLITE_OK && sqlite3_step(_statement) == SQLITE_ROW) {
+            std::string _pragma = "pragma page_size=" + std::to_string(sqlite3_column_int(_statement, 0));
+            _result = sqlite3_exec(_memory, _pragma.c_str(), nullptr, nullptr, nullptr);
+        }
+        sqlite3_finalize(_statement);
+        if (_result == SQLITE_OK)
+            _result = copy(_memory, _file);
+        if (_result != SQLITE_OK) {
+            sqlite3_close(_file);
+            OSMemoryPool::connectionClosed();
+            throw OSException("OSMirror error: Cannot load the database into memory.", _result);
+        }
+        
+        sqlite3_commit_hook(_memory, &OSMirror::commit, this);
+        if (!_readOnly && _flushInterval.count() > 0)
+            _flusher = std::thread(&OSMirror::run, this);
+    }
+    
+    OSMirror::~OSMirror()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            _stopped = true;
+            _stop.notify_all();
+        }
+        if (_flusher.joinable())
+            _flusher.join();
+        sqlite3_commit_hook(_memory, nullptr, nullptr);
+        try {
+            this->flush();
+        } catch (const OSException&) {
+            // Lost, unless flush() was called before.
+        }
+        sqlite3_close(_file);
+        OSMemoryPool::connectionClosed();
+    }
+    
+    inline int OSMirror::copy(sqlite3* destination_, sqlite3* source_) noexcept
+    {
+        sqlite3_backup* _backup = sqlite3_backup_init(destination_, "main", source_, "main");
+        if (_backup == nullptr)
+            return sqlite3_errcode(destination_);
+        int _result = sqlite3_backup_step(_backup, -1);
+        int _finish = sqlite3_backup_finish(_backup);
+        return _result == SQLITE_DONE ? _finish : _result;
+    }
+    
+    inline int OSMirror::commit(void* mirror_) noexcept
+    {
+        ++((OSMirror*)mirror_)->_commits;
+        // 0 lets the commit go on.
+        return 0;
+    }
+    
+    inline void OSMirror::run() noexcept
+    {
+        std::unique_lock<std::mutex> _lock(_mutex);
+        while (!_stop.wait_for(_lock, _flushInterval, [this]() {return _stopped;})) {
+            _lock.unlock();
+            try {
+                this->flush();
+            } catch (const OSException&) {
+                // Retried at the next interval.
+            }
+            _lock.lock();
+        }
+    }
+    
+    inline void OSMirror::flush() throw(OSException)
+    {
+        std::lock_guard<std::mutex> _lock(_flushMutex);
+        unsigned long long _committed = _commits;
+        if (_readOnly || _committed == _flushedCommits)
+            return;
+        int _result = copy(_file, _memory);
+        if (_result != SQLITE_OK)
+            throw OSException("OSMirror error: Cannot flush the database to its file.", _result);
+        _flushedCommits = _committed;
+    }
+    
+    
+    
+    
+    // Functions for OSPooledDatabase
+    OSPooledDatabase::OSPooledDatabase(OSDatabasePool& pool_, OSDatabase& database_, bool writer_) noexcept : _pool(&pool_), _database(&database_), _writer(writer_)
+    {}
+    
+    OSPooledDatabase::OSPooledDatabase(OSPooledDatabase&& other_) noexcept : _pool(other_._pool), _database(other_._database), _writer(other_._writer)
+    {
+        other_._database = nullptr;
+    }
+    
+    OSPooledDatabase::~OSPooledDatabase()
+    {
+        if (_database != nullptr) {
+            _pool->release(_database, _writer);
+            _database = nullptr;
+        }
+    }
+    
+    inline OSDatabase& OSPooledDatabase::operator*() const noexcept
+    {return *_database;}
+    
+    inline OSDatabase* OSPooledDatabase::operator->() const noexcept
+    {return _database;}
+    
+    inline bool OSPooledDatabase::isWriter() const noexcept
+    {return _writer;}
+    
+    
+    
+    
+    // Functions for OSDatabasePool
+    OSDatabasePool::OSDatabasePool(const std::string& filePath_, size_t readerCount_) throw(OSException)
+    try {
+        // The writer creates the database and switches it to WAL mode, which
+        // is persistent, before any reader opens it.
+        OSDatabaseOptions _writerOptions = OSDatabaseOptions::oltp();
+        _writerOptions.openFlags |= SQLITE_OPEN_NOMUTEX;
+        _writer.reset(new OSDatabase(filePath_, _writerOptions));
+        
+        OSDatabaseOptions _readerOptions;
+        _readerOptions.openFlags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+        _readerOptions.busyTimeout = 5000;
+        for (size_t _i = 0; _i < readerCount_; ++_i) {
+            _readers.emplace_back(new OSDatabase(filePath_, _readerOptions));
+            _idleReaders.push_back(_readers.back().get());
+        }
+    } catch (const OSException& e) {
+        std::string _newExceptionStr = "OSDatabasePool ctor error. " + std::string(e.what());
+        throw OSException(_newExceptionStr.c_str(), e.tag());
+    }
+    
+    OSDatabasePool::~OSDatabasePool()
+    {}
+    
+    inline OSPooledDatabase OSDatabasePool::reader() throw(OSException)
+    {
+        if (_readers.empty()) {
+            return this->writer();
+        }
+        std::unique_lock<std::mutex> _lock(_mutex);
+        _released.wait(_lock, [this]() {return !_idleReaders.empty();});
+        OSDatabase* _database = _idleReaders.back();
+        _idleReaders.pop_back();
+        return OSPooledDatabase(*this, *_database, false);
+    }
+    
+    inline OSPooledDatabase OSDatabasePool::writer() throw(OSException)
+    {
+        std::unique_lock<std::mutex> _lock(_mutex);
+        _released.wait(_lock, [this]() {return _writerIdle;});
+        _writerIdle = false;
+        return OSPooledDatabase(*this, *_writer, true);
+    }
+    
+    inline OSPooledDatabase OSDatabasePool::acquire(const std::string& sqlString_) throw(OSException)
+    {
+        int _known = -1;
+        {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            auto _iter = _readOnlySQL.find(sqlString_);
+            if (_iter != _readOnlySQL.end()) {
+                _known = _iter->second ? 1 : 0;
+            }
+        }
+        if (_known != -1) {
+            return _known == 1 ? this->reader() : this->writer();
+        }
+        // Prepare it on a reader to find out. The statement stays in the
+        // reader's cache, so it is not prepared again when it is executed.
+        OSPooledDatabase _reader = this->reader();
+        sqlite3_stmt* _statement = nullptr;
+        int _result = _reader->_statementCache.acquire(sqlString_, &_statement);
+        if (_result != SQLITE_OK) {
+            throw OSException("acquire error: Cannot prepare the sqlite3_stmt.", _result);
+        }
+        bool _readOnly = sqlite3_stmt_readonly(_statement) != 0;
+        _reader->_statementCache.release(sqlString_, _statement);
+        {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            _readOnlySQL[sqlString_] = _readOnly;
+        }
+        if (_readOnly || _reader.isWriter()) {
+            return _reader;
+        }
+        {
+            // Give the reader back before waiting for the writer.
+            OSPooledDatabase _released(std::move(_reader));
+        }
+        return this->writer();
+    }
+    
+    inline size_t OSDatabasePool::readerCount() const noexcept
+    {return _readers.size();}
+    
+    inline void OSDatabasePool::release(OSDatabase* database_, bool writer_) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            if (writer_) {
+                _writerIdle = true;
+            } else {
+                _idleReaders.push_back(database_);
+            }
+        }
+        _released.notify_all();
+    }
+    
+    
+    
+    
+    
+    // Functions for OSAsyncDatabase
+    OSAsyncDatabase::OSAsyncDatabase(const std::string& filePath_, const OSDatabaseOptions& options_, size_t queueCapacity_) throw(OSException) : _database(filePath_, options_), _queueCapacity(queueCapacity_ > 0 ? queueCapacity_ : 1)
+    {
+        _worker = std::thread(&OSAsyncDatabase::run, this);
+    }
+    
+    OSAsyncDatabase::~OSAsyncDatabase()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            _stopped = true;
+        }
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+        if (_worker.joinable()) {
+            _worker.join();
+        }
+    }
+    
+    inline void OSAsyncDatabase::enqueue(std::function<void()> work_) throw(OSException)
+    {
+        std::unique_lock<std::mutex> _lock(_mutex);
+        _notFull.wait(_lock, [this]() {return _stopped || _queue.size() < _queueCapacity;});
+        if (_stopped) {
+            throw OSException("submit error: OSAsyncDatabase is stopped.");
+        }
+        _queue.push_back(std::move(work_));
+        _lock.unlock();
+        _notEmpty.notify_one();
+    }
+    
+    inline void OSAsyncDatabase::run() noexcept
+    {
+        while (true) {
+            std::function<void()> _work;
+            {
+                std::unique_lock<std::mutex> _lock(_mutex);
+                _notEmpty.wait(_lock, [this]() {return _stopped || !_queue.empty();});
+                // Submitted work is finished before stopping.
+                if (_queue.empty()) {
+                    return;
+                }
+                _work = std::move(_queue.front());
+                _queue.pop_front();
+            }
+            _notFull.notify_one();
+            _work();
+        }
+    }
+    
+    template <typename Task>
+    std::future<typename std::result_of<Task(OSDatabase&)>::type> OSAsyncDatabase::submit(Task task_) throw(OSException)
+    {
+        typedef typename std::result_of<Task(OSDatabase&)>::type _Result_;
+        // std::function needs a copyable target, so the task is shared.
+        auto _task = std::make_shared<std::packaged_task<_Result_(OSDatabase&)>>(std::move(task_));
+        std::future<_Result_> _future = _task->get_future();
+        this->enqueue([this, _task]() {(*_task)(_database);});
+        return _future;
+    }
+    
+    template <typename Task, typename Callback>
+    void OSAsyncDatabase::submit(Task task_, Callback callback_) throw(OSException)
+    {
+        typedef typename std::result_of<Task(OSDatabase&)>::type _Result_;
+        auto _task = std::make_shared<std::packaged_task<_Result_(OSDatabase&)>>(std::move(task_));
+        this->enqueue([this, _task, callback_]() mutable {
+            (*_task)(_database);
+            try {
+                callback_(_task->get_future());
+            } catch (...) {
+                // Nobody to report to on the worker thread.
+            }
+        });
+    }
+    
+    template <typename... Args>
+    std::future<void> OSAsyncDatabase::execute(const std::string& sqlString_, const Args&... args_) throw(OSException)
+    {
+        return this->submit([sqlString_, args_...](OSDatabase& database_) {
+            OSStatement(database_).execute(sqlString_, args_...);
+        });
+    }
+    
+    template <typename... Returns, typename... Args>
+    std::future<std::vector<std::tuple<Returns...>>> OSAsyncDatabase::executeRows(const std::string& sqlString_, const Args&... args_) throw(OSException)
+    {
+        return this->submit([sqlString_, args_...](OSDatabase& database_) {
+            return OSStatement(database_).executeRows<Returns...>(sqlString_, args_...);
+        });
+    }
+    
+    template <typename R, typename... Args>
+    std::future<R> OSAsyncDatabase::executeScalar(const std::string& sqlString_, const Args&... args_) throw(OSException)
+    {
+        return this->submit([sqlString_, args_...](OSDatabase& database_) {
+            return OSStatement(database_).executeScalar<R>(sqlString_, args_...);
+        });
+    }
+    
+    template <typename Table>
+    std::future<void> OSAsyncDatabase::save(Table& table_) throw(OSException)
+    {
+        return this->submit([&table_](OSDatabase& database_) {OSQuery(database_).save(table_);});
+    }
+    
+    template <typename Table>
+    std::future<bool> OSAsyncDatabase::exists(Table& table_) throw(OSException)
+    {
+        return this->submit([&table_](OSDatabase& database_) {return OSQuery(database_).exists(table_);});
+    }
+    
+    template <typename Table>
+    std::future<bool> OSAsyncDatabase::fill(Table& table_) throw(OSException)
+    {
+        return this->submit([&table_](OSDatabase& database_) {return OSQuery(database_).fill(table_);});
+    }
+    
+    template <typename Table>
+    std::future<void> OSAsyncDatabase::update(Table& table_) throw(OSException)
+    {
+        return this->submit([&table_](OSDatabase& database_) {OSQuery(database_).update(table_);});
+    }
+    
+    template <typename Table>
+    std::future<bool> OSAsyncDatabase::saveOrUpdate(Table& table_) throw(OSException)
+    {
+        return this->submit([&table_](OSDatabase& database_) {return OSQuery(database_).saveOrUpdate(table_);});
+    }
+    
+    template <typename Table>
+    std::future<void> OSAsyncDatabase::deleteObject(Table& table_) throw(OSException)
+    {
+        return this->submit([&table_](OSDatabase& database_) {OSQuery(database_).deleteObject(table_);});
+    }
+    
+    inline size_t OSAsyncDatabase::pending() noexcept
+    {
+        std::lock_guard<std::mutex> _lock(_mutex);
+        return _queue.size();
+    }
+    
+    inline size_t OSAsyncDatabase::queueCapacity() const noexcept
+    {return _queueCapacity;}
+    
+    
+    
+    
+    
+    // Functions for OSGroupCommitQueue
+    OSGroupCommitQueue::OSGroupCommitQueue(const std::string& filePath_, size_t maxBatch_, std::chrono::microseconds window_, const OSDatabaseOptions& options_) throw(OSException) : _database(filePath_, options_), _maxBatch(maxBatch_ > 0 ? maxBatch_ : 1), _window(window_), _head(new Node), _stopped(false), _sleeping(false), _batches(0), _operations(0)
+    {
+        _tail = _head.load();
+        _writer = std::thread(&OSGroupCommitQueue::run, this);
+    }
+    
+    OSGroupCommitQueue::~OSGroupCommitQueue()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            _stopped = true;
+        }
+        _wakeUp.notify_one();
+        if (_writer.joinable()) {
+            _writer.join();
+        }
+        while (_tail != nullptr) {
+            Node* _next = _tail->next.load();
+            delete _tail;
+            _tail = _next;
+        }
+    }
+    
+    inline void OSGroupCommitQueue::push(Node* node_) noexcept
+    {
+        node_->next.store(nullptr, std::memory_order_relaxed);
+        Node* _previous = _head.exchange(node_, std::memory_order_acq_rel);
+        _previous->next.store(node_, std::memory_order_release);
+        // Store then load, as wait() does the reverse: without the fences
+        // both could miss the other, and the wake-up would be lost.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Lock only to wake the writer up, not to queue.
+        if (_sleeping.load()) {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            _wakeUp.notify_one();
+        }
+    }
+    
+    inline bool OSGroupCommitQueue::pop(Operation& operation_) noexcept
+    {
+        Node* _next = _tail->next.load(std::memory_order_acquire);
+        if (_next == nullptr) {
+            return false;
+        }
+        operation_ = std::move(_next->operation);
+        delete _tail;
+        _tail = _next;
+        return true;
+    }
+    
+    inline bool OSGroupCommitQueue::wait(std::chrono::steady_clock::time_point deadline_) noexcept
+    {
+        std::unique_lock<std::mutex> _lock(_mutex);
+        _sleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool _ready = _wakeUp.wait_until(_lock, deadline_, [this]() {
+            return _tail->next.load(std::memory_order_acquire) != nullptr || _stopped.load();
+        });
+        _sleeping = false;
+        return _ready && _tail->next.load(std::memory_order_acquire) != nullptr;
+    }
+    
+    inline bool OSGroupCommitQueue::executeOne(Operation& operation_, std::vector<Operation>& batch_) noexcept
+    {
+        sqlite3* _connection = _database._connection;
+        int _result = sqlite3_exec(_connection, "savepoint OSGroupCommit", nullptr, nullptr, nullptr);
+        if (_result != SQLITE_OK) {
+            operation_.committed.set_exception(std::make_exception_ptr(OSException("group commit error: Cannot open the savepoint.", _result)));
+            return true;
+        }
+        try {
+            operation_.write(_database);
+            sqlite3_exec(_connection, "release OSGroupCommit", nullptr, nullptr, nullptr);
+            batch_.push_back(std::move(operation_));
+            return true;
+        } catch (...) {
+            sqlite3_exec(_connection, "rollback to OSGroupCommit; release OSGroupCommit", nullptr, nullptr, nullptr);
+            operation_.committed.set_exception(std::current_exception());
+        }
+        if (sqlite3_get_autocommit(_connection) == 0) {
+            return true;
+        }
+        // The failure rolled the whole transaction back, with the operations
+        // of the batch so far.
+        for (auto& _rolledBack : batch_) {
+            _rolledBack.committed.set_exception(std::make_exception_ptr(OSException("group commit error: The transaction was rolled back.", SQLITE_ABORT)));
+        }
+        batch_.clear();
+        return false;
+    }
+    
+    inline void OSGroupCommitQueue::run() noexcept
+    {
+        sqlite3* _connection = _database._connection;
+        std::vector<Operation> _batch;
+        _batch.reserve(_maxBatch);
+        while (true) {
+            Operation _operation;
+            if (!this->pop(_operation)) {
+                if (!_stopped.load()) {
+                    this->wait(std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+                    continue;
+                }
+                // Submitted writes are finished before stopping.
+                if (!this->pop(_operation)) {
+                    return;
+                }
+            }
+            
+            int _result = sqlite3_exec(_connection, "begin immediate", nullptr, nullptr, nullptr);
+            if (_result != SQLITE_OK) {
+                _operation.committed.set_exception(std::make_exception_ptr(OSException("group commit error: Cannot begin the transaction.", _result)));
+                continue;
+            }
+            
+            // Gather the batch until it is full or the window is over.
+            auto _deadline = std::chrono::steady_clock::now() + _window;
+            size_t _count = 0;
+            bool _open = true;
+            bool _more = true;
+            while (_more) {
+                _open = this->executeOne(_operation, _batch);
+                if (!_open || ++_count == _maxBatch) {
+                    break;
+                }
+                _more = this->pop(_operation) || (this->wait(_deadline) && this->pop(_operation));
+            }
+            if (!_open) {
+                // The batch failed with its transaction, the next one begins anew.
+                continue;
+            }
+            
+            _result = sqlite3_exec(_connection, "commit", nullptr, nullptr, nullptr);
+            if (_result == SQLITE_OK) {
+                ++_batches;
+                _operations += _batch.size();
+                for (auto& _committed : _batch) {
+                    _committed.committed.set_value();
+                }
+            } else {
+                sqlite3_exec(_connection, "rollback", nullptr, nullptr, nullptr);
+                for (auto& _committed : _batch) {
+                    _committed.committed.set_exception(std::make_exception_ptr(OSException("group commit error: Cannot commit the transaction.", _result)));
+                }
+            }
+            _batch.clear();
+        }
+    }
+    
+    inline std::future<void> OSGroupCommitQueue::submit(std::function<void(OSDatabase&)> write_) throw(OSException)
+    {
+        if (_stopped.load()) {
+            throw OSException("submit error: OSGroupCommitQueue is stopped.");
+        }
+        Node* _node = new Node;
+        _node->operation.write = std::move(write_);
+        std::future<void> _future = _node->operation.committed.get_future();
+        this->push(_node);
+        return _future;
+    }
+    
+    template <typename... Args>
+    std::future<void> OSGroupCommitQueue::execute(const std::string& sqlString_, const Args&... args_) throw(OSException)
+    {
+        return this->submit([sqlString_, args_...](OSDatabase& database_) {
+            OSStatement(database_).execute(sqlString_, args_...);
+        });
+    }
+    
+    inline unsigned long long OSGroupCommitQueue::batches() const noexcept
+    {return _batches.load();}
+    
+    inline unsigned long long OSGroupCommitQueue::operations() const noexcept
+    {return _operations.load();}
+    
+    
+    
+    
+    // Functions for OSMappedFile
+    OSMappedFile::OSMappedFile(const std::string& filePath_) throw(OSException)
+    {
+#ifdef _MSC_VER
+        _file = CreateFileA(filePath_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (_file == INVALID_HANDLE_VALUE)
+            throw OSException("OSMappedFile error: Cannot open the file.", SQLITE_CANTOPEN);
+        LARGE_INTEGER _fileSize;
+        if (!GetFileSizeEx(_file, &_fileSize)) {
+            CloseHandle(_file);
+            throw OSException("OSMappedFile error: Cannot get the size of the file.", SQLITE_IOERR);
+        }
+        _size = (size_t)_fileSize.QuadPart;
+        if (_size > 0) {
+            _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (_mapping != nullptr)
+                _data = (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+            if (_data == nullptr) {
+                if (_mapping != nullptr)
+                    CloseHandle(_mapping);
+                CloseHandle(_file);
+                throw OSException("OSMappedFile error: Cannot map the file.", SQLITE_IOERR);
+            }
+        }
+#else
+        int _descriptor = ::open(filePath_.c_str(), O_RDONLY);
+        if (_descriptor < 0)
+            throw OSException("OSMappedFile error: Cannot open the file.", SQLITE_CANTOPEN);
+        struct stat _status;
+        if (::fstat(_descriptor, &_status) != 0) {
+            ::close(_descriptor);
+            throw OSException("OSMappedFile error: Cannot get the size of the file.", SQLITE_IOERR);
+        }
+        _size = (size_t)_status.st_size;
+        if (_size > 0) {
+            void* _mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _descriptor, 0);
+            if (_mapped == MAP_FAILED) {
+                ::close(_descriptor);
+                throw OSException("OSMappedFile error: Cannot map the file.", SQLITE_IOERR);
+            }
+            // Read once from the beginning to the end.
+            ::madvise(_mapped, _size, MADV_SEQUENTIAL);
+            _data = (const char*)_mapped;
+        }
+        // The mapping stays valid without the descriptor.
+        ::close(_descriptor);
+#endif
+    }
+    
+    OSMappedFile::~OSMappedFile()
+    {
+#ifdef _MSC_VER
+        if (_data != nullptr)
+            UnmapViewOfFile(_data);
+        if (_mapping != nullptr)
+            CloseHandle(_mapping);
+        CloseHandle(_file);
+#else
+        if (_data != nullptr)
+            ::munmap((void*)_data, _size);
+#endif
+    }
+    
+    inline const char* OSMappedFile::data() const noexcept
+    {return _data;}
+    
+    inline size_t OSMappedFile::size() const noexcept
+    {return _size;}
+    
+    
+    
+    
+    // Functions for OSBulkLoader
+    inline double OSBulkLoadStatistics::rowsPerSecond() const noexcept
+    {return elapsed.count() > 0 ? rows * 1000000.0 / elapsed.count() : 0;}
+    
+    OSBulkLoader::OSBulkLoader(OSDatabase& database_, const std::string& table_, const std::vector<std::string>& columns_, const std::vector<OSFieldType>& types_, const OSBulkLoadOptions& options_) throw(OSException) : _database(database_), _types(types_), _options(options_)
+    {
+        if (columns_.empty() || columns_.size() != types_.size())
+            throw OSException("OSBulkLoader ctor error: the numbers of columns and types differ.");
+        if (!_options.fieldWidths.empty() && _options.fieldWidths.size() != columns_.size())
+            throw OSException("OSBulkLoader ctor error: the numbers of columns and field widths differ.");
+        if (_options.batchSize == 0)
+            _options.batchSize = 1;
+        if (_options.queueCapacity == 0)
+            _options.queueCapacity = 1;
+        if (_options.parserThreads == 0) {
+            unsigned _cores = std::thread::hardware_concurrency();
+            _options.parserThreads = _cores > 2 ? _cores - 1 : 1;
+        }
+        std::string _columns, _values;
+        for (size_t _i = 0; _i < columns_.size(); ++_i) {
+            _columns += (_i == 0 ? "" : ", ") + columns_[_i];
+            _values += _i == 0 ? "?" : ", ?";
+        }
+        _sqlString = "insert into " + table_ + "(" + _columns + ") values(" + _values + ")";
+    }
+    
+    OSBulkLoader::~OSBulkLoader()
+    {}
+    
+    inline const char* OSBulkLoader::scan(const char* begin_, const char* end_, char delimiter_) noexcept
+    {
+        // SWAR: 8 bytes at a time, a byte equal to the delimiter or to '\n'
+        // makes a zero byte after the xor, found by the (x - 1) & ~x trick.
+        const uint64_t _ones = 0x0101010101010101ULL, _highs = 0x8080808080808080ULL;
+        const uint64_t _delimiters = _ones * (unsigned char)delimiter_, _newlines = _ones * (unsigned char)'\n';
+        const char* _p = begin_;
+        for (; end_ - _p >= 8; _p += 8) {
+            uint64_t _word;
+            memcpy(&_word, _p, 8);
+            uint64_t _x = _word ^ _delimiters, _y = _word ^ _newlines;
+            if ((((_x - _ones) & ~_x) | ((_y - _ones) & ~_y)) & _highs)
+                break;
+        }
+        for (; _p < end_; ++_p) {
+            if (*_p == delimiter_ || *_p == '\n')
+                return _p;
+        }
+        return end_;
+    }
+    
+    inline bool OSBulkLoader::parseInteger(const char* begin_, const char* end_, long long& value_) noexcept
+    {
+        const char* _p = begin_;
+        bool _negative = _p < end_ && *_p == '-';
+        if (_p < end_ && (*_p == '-' || *_p == '+'))
+            ++_p;
+        if (_p == end_)
+            return false;
+        // Up to 2^63 for the negative minimum.
+        const unsigned long long _limit = _negative ? 9223372036854775808ULL : 9223372036854775807ULL;
+        unsigned long long _value = 0;
+        for (; _p < end_; ++_p) {
+            unsigned _digit = (unsigned)(*_p - '0');
+            if (_digit > 9 || _value > (_limit - _digit) / 10)
+                return false;
+            _value = _value * 10 + _digit;
+        }
+        value_ = _negative ? (long long)(0 - _value) : (long long)_value;
+        return true;
+    }
+    
+    inline bool OSBulkLoader::parseReal(const char* begin_, const char* end_, double& value_) noexcept
+    {
+        // Exact powers of ten of a double.
+        static const double _powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        const char* _p = begin_;
+        bool _negative = _p < end_ && *_p == '-';
+        if (_p < end_ && (*_p == '-' || *_p == '+'))
+            ++_p;
+        unsigned long long _mantissa = 0;
+        int _digits = 0, _exponent = 0;
+        for (; _p < end_ && (unsigned)(*_p - '0') <= 9; ++_p, ++_digits)
+            _mantissa = _mantissa * 10 + (unsigned)(*_p - '0');
+        if (_p < end_ && *_p == '.') {
+            for (++_p; _p < end_ && (unsigned)(*_p - '0') <= 9; ++_p, ++_digits, --_exponent)
+                _mantissa = _mantissa * 10 + (unsigned)(*_p - '0');
+        }
+        bool _plain = _digits > 0;
+        if (_plain && _p < end_ && (*_p == 'e' || *_p == 'E')) {
+            const char* _e = _p + 1;
+            bool _negativeExponent = _e < end_ && *_e == '-';
+            if (_e < end_ && (*_e == '-' || *_e == '+'))
+                ++_e;
+            int _value = 0;
+            const char* _eStart = _e;
+            for (; _e < end_ && (unsigned)(*_e - '0') <= 9 && _value < 10000; ++_e)
+                _value = _value * 10 + (*_e - '0');
+            _plain = _e > _eStart;
+            _exponent += _negativeExponent ? -_value : _value;
+            _p = _e;
+        }
+        // Fast path: the mantissa and the power of ten are exact doubles, so
+        // one multiplication or division rounds correctly.
+        if (_plain && _p == end_ && _digits <= 19 && _mantissa <= (1ULL << 53) && _exponent >= -22 && _exponent <= 22) {
+            double _value = (double)_mantissa;
+            _value = _exponent < 0 ? _value / _powers[-_exponent] : _value * _powers[_exponent];
+            value_ = _negative ? -_value : _value;
+            return true;
+        }
+        // Otherwise strtod, on a terminated copy.
+        size_t _size = end_ - begin_;
+        if (_size == 0)
+            return false;
+        char _buffer[64];
+        std::string _long;
+        char* _text = _buffer;
+        if (_size >= sizeof(_buffer)) {
+            _long.assign(begin_, _size);
+            _text = &_long[0];
+        } else {
+            memcpy(_buffer, begin_, _size);
+            _buffer[_size] = '\0';
+        }
+        char* _parsed = nullptr;
+        value_ = strtod(_text, &_parsed);
+        return _parsed == _text + _size;
+    }
+    
+    inline void OSBulkLoader::parseField(const char* begin_, const char* end_, size_t column_, Field& field_, size_t offset_) const throw(OSException)
+    {
+        field_.text = begin_;
+        field_.size = end_ - begin_;
+        field_.null = false;
+        switch (_types[column_]) {
+            case OSFieldType::integer:
+                if (begin_ == end_)
+                    field_.null = true;
+                else if (!parseInteger(begin_, end_, field_.integer))
+                    throw OSException(("OSBulkLoader error: bad integer at byte " + std::to_string(offset_) + ".").c_str(), SQLITE_MISMATCH);
+                break;
+            case OSFieldType::real:
+                if (begin_ == end_)
+                    field_.null = true;
+                else if (!parseReal(begin_, end_, field_.real))
+                    throw OSException(("OSBulkLoader error: bad real at byte " + std::to_string(offset_) + ".").c_str(), SQLITE_MISMATCH);
+                break;
+            case OSFieldType::text:
+                break;
+        }
+    }
+    
+    inline const char* OSBulkLoader::parseDelimited(const char* begin_, const char* end_, const char* fileBegin_, Batch& batch_) const throw(OSException)
+    {
+        const char _delimiter = _options.delimiter, _quote = _options.quote;
+        const char* _p = begin_;
+        for (size_t _column = 0; ; ++_column) {
+            if (_column == _types.size())
+                throw OSException(("OSBulkLoader error: too many fields in the record at byte " + std::to_string(begin_ - fileBegin_) + ".").c_str(), SQLITE_MISMATCH);
+            batch_.fields.push_back(Field());
+            Field& _field = batch_.fields.back();
+            if (_quote != 0 && _p < end_ && *_p == _quote) {
+                // Quoted: up to the quote not doubled.
+                const char* _start = _p + 1;
+                const char* _q = _start;
+                bool _escaped = false;
+                while (true) {
+                    _q = (const char*)memchr(_q, _quote, end_ - _q);
+                    if (_q == nullptr)
+                        throw OSException(("OSBulkLoader error: unterminated quote at byte " + std::to_string(_p - fileBegin_) + ".").c_str(), SQLITE_MISMATCH);
+                    if (_q + 1 < end_ && _q[1] == _quote) {
+                        _escaped = true;
+                        _q += 2;
+                        continue;
+                    }
+                    break;
+                }
+                if (_escaped) {
+                    batch_.unescaped.push_back(std::string());
+                    std::string& _text = batch_.unescaped.back();
+                    _text.reserve(_q - _start);
+                    for (const char* _c = _start; _c < _q; ++_c) {
+                        _text.push_back(*_c);
+                        if (*_c == _quote)
+                            ++_c;
+                    }
+                    this->parseField(_text.data(), _text.data() + _text.size(), _column, _field, _start - fileBegin_);
+                } else {
+                    this->parseField(_start, _q, _column, _field, _start - fileBegin_);
+                }
+                _p = _q + 1;
+            } else {
+                const char* _fieldEnd = scan(_p, end_, _delimiter);
+                const char* _valueEnd = _fieldEnd;
+                if ((_fieldEnd == end_ || *_fieldEnd == '\n') && _valueEnd > _p && _valueEnd[-1] == '\r')
+                    --_valueEnd;
+                this->parseField(_p, _valueEnd, _column, _field, _p - fileBegin_);
+                _p = _fieldEnd;
+            }
+            if (_p < end_ && *_p == _delimiter) {
+                ++_p;
+                continue;
+            }
+            if (_p < end_ && *_p == '\r')
+                ++_p;
+            if (_p < end_ && *_p != '\n')
+                throw OSException(("OSBulkLoader error: unexpected character after a quoted field at byte " + std::to_string(_p - fileBegin_) + ".").c_str(), SQLITE_MISMATCH);
+            if (_column + 1 != _types.size())
+                throw OSException(("OSBulkLoader error: too few fields in the record at byte " + std::to_string(begin_ - fileBegin_) + ".").c_str(), SQLITE_MISMATCH);
+            return _p < end_ ? _p + 1 : end_;
+        }
+    }
+    
+    inline const char* OSBulkLoader::parseFixedWidth(const char* begin_, const char* end_, const char* fileBegin_, Batch& batch_) const throw(OSException)
+    {
+        const char* _lineEnd = (const char*)memchr(begin_, '\n', end_ - begin_);
+        const char* _next = _lineEnd == nullptr ? end_ : _lineEnd + 1;
+        if (_lineEnd == nullptr)
+            _lineEnd = end_;
+        if (_lineEnd > begin_ && _lineEnd[-1] == '\r')
+            --_lineEnd;
+        // A short line gives empty fields at its end.
+        const size_t _length = _lineEnd - begin_;
+        size_t _offset = 0;
+        for (size_t _column = 0; _column < _types.size(); ++_column) {
+            const char* _fieldBegin = begin_ + std::min(_offset, _length);
+            const char* _fieldEnd = begin_ + std::min(_offset + _options.fieldWidths[_column], _length);
+            while (_fieldBegin < _fieldEnd && *_fieldBegin == ' ')
+                ++_fieldBegin;
+            while (_fieldEnd > _fieldBegin && _fieldEnd[-1] == ' ')
+                --_fieldEnd;
+            batch_.fields.push_back(Field());
+            this->parseField(_fieldBegin, _fieldEnd, _column, batch_.fields.back(), _fieldBegin - fileBegin_);
+            _offset += _options.fieldWidths[_column];
+        }
+        return _next;
+    }
+    
+    inline bool OSBulkLoader::push(std::unique_ptr<Batch>& batch_) noexcept
+    {
+        std::unique_lock<std::mutex> _lock(_mutex);
+        _consumed.wait(_lock, [this]() {return _aborted || _queue.size() < _options.queueCapacity;});
+        if (_aborted)
+            return false;
+        _queue.push_back(std::move(batch_));
+        _parsed.notify_one();
+        return true;
+    }
+    
+    inline void OSBulkLoader::parse(const char* begin_, const char* end_, const char* fileBegin_, const char* fileEnd_) noexcept
+    {
+        // The records starting in [begin_, end_), the last one may run to the
+        // end of the file.
+        std::unique_ptr<Batch> _batch;
+        try {
+            const char* _p = begin_;
+            while (_p < end_) {
+                if (*_p == '\n' || (*_p == '\r' && _p + 1 < fileEnd_ && _p[1] == '\n')) {
+                    _p += *_p == '\n' ? 1 : 2;
+                    continue;
+                }
+                if (!_batch) {
+                    std::lock_guard<std::mutex> _lock(_mutex);
+                    if (_aborted)
+                        break;
+                    if (_freeBatches.empty()) {
+                        _batch.reset(new Batch());
+                        _batch->fields.reserve(_options.batchSize * _types.size());
+                    } else {
+                        _batch = std::move(_freeBatches.back());
+                        _freeBatches.pop_back();
+                    }
+                }
+                const char* _record = _p;
+                _p = _options.fieldWidths.empty() ? this->parseDelimited(_p, fileEnd_, fileBegin_, *_batch) : this->parseFixedWidth(_p, fileEnd_, fileBegin_, *_batch);
+                // The next parser started inside this record: the chunks were
+                // split by the quotes, and one is not at the start of a field.
+                if (_p > end_ && end_ != fileEnd_)
+                    throw OSException(("OSBulkLoader error: the record at byte " + std::to_string(_record - fileBegin_) + " crosses a parser chunk, a quote is not at the start of a field.").c_str(), SQLITE_MISMATCH);
+                if (++_batch->rows == _options.batchSize && !this->push(_batch))
+                    break;
+            }
+            if (_batch && _batch->rows > 0)
+                this->push(_batch);
+        } catch (...) {
+            std::lock_guard<std::mutex> _lock(_mutex);
+            if (!_error)
+                _error = std::current_exception();
+            _aborted = true;
+            _consumed.notify_all();
+        }
+        std::lock_guard<std::mutex> _lock(_mutex);
+        --_runningParsers;
+        _parsed.notify_all();
+    }
+    
+    inline std::unique_ptr<OSBulkLoader::Batch> OSBulkLoader::nextBatch() noexcept
+    {
+        std::unique_lock<std::mutex> _lock(_mutex);
+        _parsed.wait(_lock, [this]() {return _aborted || !_queue.empty() || _runningParsers == 0;});
+        if (_aborted || _queue.empty())
+            return nullptr;
+        std::unique_ptr<Batch> _batch = std::move(_queue.front());
+        _queue.pop_front();
+        _consumed.notify_one();
+        return _batch;
+    }
+    
+    inline void OSBulkLoader::write(OSBulkLoadStatistics& statistics_, std::chrono::steady_clock::time_point start_) throw(OSException)
+    {
+        OSStatementCache& _cache = _database.statementCache();
+        OSStatement _transaction(_database);
+        sqlite3_stmt* _statement = nullptr;
+        int _result = _cache.acquire(_sqlString, &_statement);
+        if (_result != SQLITE_OK)
+            throw OSException("OSBulkLoader error: Cannot prepare the sqlite3_stmt.", _result);
+        bool _open = false;
+        size_t _rows = 0;
+        const int _columns = (int)_types.size();
+        try {
+            while (std::unique_ptr<Batch> _batch = this->nextBatch()) {
+                if (!_open) {
+                    _transaction.begin();
+                    _open = true;
+                }
+                const Field* _field = _batch->fields.data();
+                for (size_t _row = 0; _row < _batch->rows; ++_row) {
+                    for (int _column = 0; _column < _columns; ++_column, ++_field) {
+                        // The batch outlives the step: text is not copied.
+                        if (_field->null)
+                            _result = sqlite3_bind_null(_statement, _column + 1);
+                        else if (_types[_column] == OSFieldType::integer)
+                            _result = sqlite3_bind_int64(_statement, _column + 1, _field->integer);
+                        else if (_types[_column] == OSFieldType::real)
+                            _result = sqlite3_bind_double(_statement, _column + 1, _field->real);
+                        else
+                            _result = sqlite3_bind_text(_statement, _column + 1, _field->text, (int)_field->size, SQLITE_STATIC);
+                        if (_result != SQLITE_OK)
+                            throw OSException("OSBulkLoader error. Bind parameter failed.", _result);
+                    }
+                    _result = _cache.step(_statement);
+                    sqlite3_reset(_statement);
+                    if (_result != SQLITE_DONE)
+                        throw OSException("OSBulkLoader error. Insert failed.", _result);
+                }
+                statistics_.rows += _batch->rows;
+                ++statistics_.batches;
+                _rows += _batch->rows;
+                // Give the batch back to the parsers.
+                _batch->rows = 0;
+                _batch->fields.clear();
+                _batch->unescaped.clear();
+                {
+                    std::lock_guard<std::mutex> _lock(_mutex);
+                    _freeBatches.push_back(std::move(_batch));
+                }
+                if (_options.transactionSize > 0 && _rows >= _options.transactionSize) {
+                    _transaction.commit();
+                    _open = false;
+                    _rows = 0;
+                    ++statistics_.transactions;
+                    statistics_.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_);
+                    if (_options.progress)
+                        _options.progress(statistics_);
+                }
+            }
+            {
+                std::lock_guard<std::mutex> _lock(_mutex);
+                if (_error)
+                    std::rethrow_exception(_error);
+            }
+            if (_open) {
+                _transaction.commit();
+                _open = false;
+                ++statistics_.transactions;
+                statistics_.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_);
+                if (_options.progress)
+                    _options.progress(statistics_);
+            }
+        } catch (...) {
+            sqlite3_clear_bindings(_statement);
+            _cache.release(_sqlString, _statement);
+            if (_open) {
+                try {
+                    _transaction.rollback();
+                } catch (const OSException&) {
+                    // Rolled back by SQLite already.
+                }
+            }
+            throw;
+        }
+        sqlite3_clear_bindings(_statement);
+        _cache.release(_sqlString, _statement);
+    }
+    
+    inline OSBulkLoadStatistics OSBulkLoader::load(const std::string& filePath_) throw(OSException)
+    {
+        OSBulkLoadStatistics _statistics;
+        auto _start = std::chrono::steady_clock::now();
+        OSMappedFile _file(filePath_);
+        _statistics.bytes = _file.size();
+        const char* _begin = _file.data();
+        const char* _end = _begin + _file.size();
+        if (_options.header && _begin != _end) {
+            const char* _lineEnd = (const char*)memchr(_begin, '\n', _end - _begin);
+            _begin = _lineEnd == nullptr ? _end : _lineEnd + 1;
+        }
+        
+        // Chunks of the parsers start at the beginning of a record: a line
+        // break outside quotes, told by the parity of the quotes before it.
+        const char _quote = _options.fieldWidths.empty() ? _options.quote : 0;
+        std::vector<const char*> _bounds(1, _begin);
+        const char* _counted = _begin;
+        bool _quoted = false;
+        for (size_t _i = 1; _i < _options.parserThreads; ++_i) {
+            const char* _bound = _begin + (_end - _begin) * _i / _options.parserThreads;
+            if (_bound <= _bounds.back()) {
+                _bounds.push_back(_bounds.back());
+                continue;
+            }
+            const char* _p = _bound - 1;
+            if (_quote != 0) {
+                for (const char* _q; (_q = (const char*)memchr(_counted, _quote, _p - _counted)) != nullptr; _counted = _q + 1)
+                    _quoted = !_quoted;
+            }
+            for (; _p < _end; ++_p) {
+                if (_quote != 0 && *_p == _quote)
+                    _quoted = !_quoted;
+                else if (*_p == '\n' && !_quoted)
+                    break;
+            }
+            _bound = _p < _end ? _p + 1 : _end;
+            _counted = _bound;
+            _bounds.push_back(_bound);
+        }
+        _bounds.push_back(_end);
+        
+        OSDatabaseOptions _previous;
+        if (_options.bulkPragmas) {
+            OSStatement _statement(_database);
+            _previous.journalMode = _statement.executeScalar<std::string>("pragma journal_mode");
+            _previous.synchronous = _statement.executeScalar<int>("pragma synchronous");
+            _previous.cacheSize = _statement.executeScalar<long>("pragma cache_size");
+            _previous.tempStore = _statement.executeScalar<int>("pragma temp_store");
+            _database.applyOptions(OSDatabaseOptions::bulkLoad());
+        }
+        
+        _queue.clear();
+        _aborted = false;
+        _error = nullptr;
+        _runningParsers = _bounds.size() - 1;
+        std::vector<std::thread> _parsers;
+        try {
+            for (size_t _i = 0; _i + 1 < _bounds.size(); ++_i) {
+                _parsers.push_back(std::thread(&OSBulkLoader::parse, this, _bounds[_i], _bounds[_i + 1], _file.data(), _end));
+            }
+            this->write(_statistics, _start);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> _lock(_mutex);
+                _aborted = true;
+                _runningParsers -= (_bounds.size() - 1) - _parsers.size();
+                _consumed.notify_all();
+            }
+            for (auto& _parser : _parsers)
+                _parser.join();
+            if (_options.bulkPragmas) {
+                try {
+                    _database.applyOptions(_previous);
+                } catch (const OSException&) {
+                    // The load error is reported.
+                }
+            }
+            throw;
         }
+        for (auto& _parser : _parsers)
+            _parser.join();
+        if (_options.bulkPragmas)
+            _database.applyOptions(_previous);
+        _statistics.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _start);
+        return _statistics;
     }
     
 }
\ No newline at end of file
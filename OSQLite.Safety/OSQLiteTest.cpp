@@ -7,6 +7,10 @@
 //
 
 #include "OSQLite.h"
+#include <list>
+#include <thread>
+#include <atomic>
+#include <fstream>
 
 // Pre-defines
 #define TEST_SUCCESS(func_name) std::cout<<">> "<<#func_name<<"... SUCCESS"<<std::endl
@@ -17,6 +21,68 @@ std::string databaseFilePath = "c://software/sqlite3/sqlitedb";
 std::string databaseFilePath = "/Users/Steven/Documents/Database/sqlitedb";
 #endif
 
+// Test: check OSMemoryPool serving SQLite and OSPoolAllocator. It runs
+// first, as SQLite is reconfigured with no connection open; the other tests
+// then run on the pool too.
+void test_OSMemoryPool()
+try {
+    using namespace OSQLite;
+    OSMemoryOptions _options;
+    _options.pageCacheSlotSize = 4096 + 256;
+    _options.pageCacheSlots = 64;
+    _options.lookasideSlotSize = 128;
+    _options.lookasideSlots = 64;
+    OSMemoryPool::configure(_options);
+    
+    auto _before = OSMemoryPool::statistics();
+    {
+        OSDatabase _database(databaseFilePath);
+        OSStatement _statement(_database);
+        _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+        std::string _name = "steven";
+        std::string _address = "shanghai";
+        for (int _id = 1; _id <= 100; ++_id) {
+            _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, _name, _address);
+        }
+        auto _sqlite = OSMemoryPool::statistics();
+        if (_sqlite.allocations <= _before.allocations || _sqlite.sqliteMemoryUsed <= 0 || _sqlite.pageCacheUsed <= 0) {
+            throw OSException("Failed, 1");
+        }
+        
+        // Rows in a caller supplied container.
+        std::vector<std::tuple<int, std::string>, OSPoolAllocator<std::tuple<int, std::string>>> _rows;
+        int _limit = 10;
+        _statement.executeRows(_rows, "select id, name from Person where id<=?", _limit);
+        _statement.executeRows(_rows, "select id, name from Person where id<=?", _limit);
+        if (_rows.size() != 20 || std::get<1>(_rows[19]) != "steven" || OSMemoryPool::statistics().allocations <= _sqlite.allocations) {
+            throw OSException("Failed, 2");
+        }
+        
+        // Not while a connection is open.
+        try {
+            OSMemoryPool::configure(_options);
+            throw OSException("Failed, 4");
+        } catch (const OSException& e) {
+            if (e.tag() != SQLITE_MISUSE) {
+                throw;
+            }
+        }
+        _statement.execute("insert into Person(id, name, address) values(101, 'xiaoyu', 'CUC')");
+        _statement.execute("drop table Person");
+    }
+    auto _after = OSMemoryPool::statistics();
+    if (_after.frees <= _before.frees || _after.peakBytesInUse < _after.bytesInUse || _after.bytesReserved == 0) {
+        throw OSException("Failed, 3");
+    }
+    // Closed again, so it may be configured.
+    OSMemoryPool::configure(_options);
+    
+    TEST_SUCCESS(OSMemoryPool);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSMemoryPool);
+}
+
 // Test: check the behavior of OSDatabase
 void test_OSDatabase_ctors_dtors()
 try{
@@ -28,6 +94,272 @@ try{
     TEST_FAIL(ctor_dtors);
 }
 
+// Test: check OSDatabaseOptions and the tuning profiles
+void test_OSDatabase_options()
+try {
+    using namespace OSQLite;
+    std::string _filePath = databaseFilePath + "_options";
+    {
+        OSDatabase _database(_filePath, OSDatabaseOptions::oltp());
+        OSStatement _statement(_database);
+        if (_statement.executeScalar<std::string>("pragma journal_mode") != "wal" || _statement.executeScalar<int>("pragma synchronous") != 1) {
+            throw OSException("Failed, 1");
+        }
+        _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+        
+        // Switch profile at runtime.
+        _database.applyOptions(OSDatabaseOptions::bulkLoad());
+        if (_statement.executeScalar<std::string>("pragma journal_mode") != "memory" || _statement.executeScalar<int>("pragma synchronous") != 0) {
+            throw OSException("Failed, 2");
+        }
+    }
+    {
+        OSDatabase _database(_filePath, OSDatabaseOptions::readOnlyAnalytics());
+        OSStatement _statement(_database);
+        if (_statement.executeScalar<long>("pragma mmap_size") != 268435456 || _statement.executeScalar<int>("select count(*) from Person") != 0) {
+            throw OSException("Failed, 3");
+        }
+        try {
+            _statement.execute("drop table Person");
+            throw OSException("Failed, 4");
+        } catch (const OSException& e) {
+            if (std::string(e.what()) == "Failed, 4") {
+                throw;
+            }
+        }
+    }
+    OSDatabase _database(_filePath);
+    OSStatement(_database).execute("drop table Person");
+    
+    TEST_SUCCESS(options);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(options);
+}
+
+// Test: check OSDatabasePool with concurrent readers and a writer
+void test_OSDatabasePool()
+try {
+    using namespace OSQLite;
+    OSDatabasePool _pool(databaseFilePath + "_pool", 4);
+    {
+        OSPooledDatabase _writer = _pool.writer();
+        OSStatement _statement(*_writer);
+        _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    }
+    
+    // Read-only SQL goes to a reader, the rest to the writer.
+    if (_pool.acquire("select count(*) from Person").isWriter() || !_pool.acquire("delete from Person").isWriter()) {
+        throw OSException("Failed, 1");
+    }
+    
+    std::atomic<int> _failures(0);
+    std::vector<std::thread> _threads;
+    _threads.emplace_back([&_pool, &_failures]() {
+        try {
+            std::string _name = "steven";
+            std::string _address = "shanghai";
+            for (int _id = 1; _id <= 200; ++_id) {
+                OSPooledDatabase _writer = _pool.acquire("insert into Person(id, name, address) values(?, ?, ?)");
+                OSStatement(*_writer).execute("insert into Person(id, name, address) values(?, ?, ?)", _id, _name, _address);
+            }
+        } catch (const OSException& e) {
+            ++_failures;
+        }
+    });
+    for (int _i = 0; _i < 8; ++_i) {
+        _threads.emplace_back([&_pool, &_failures]() {
+            try {
+                int _last = 0;
+                for (int _j = 0; _j < 100; ++_j) {
+                    OSPooledDatabase _reader = _pool.reader();
+                    int _count = OSStatement(*_reader).executeScalar<int>("select count(*) from Person");
+                    if (_count < _last) {
+                        ++_failures;
+                    }
+                    _last = _count;
+                }
+            } catch (const OSException& e) {
+                ++_failures;
+            }
+        });
+    }
+    for (auto& _thread : _threads) {
+        _thread.join();
+    }
+    if (_failures != 0) {
+        throw OSException("Failed, 2");
+    }
+    
+    OSPooledDatabase _reader = _pool.reader();
+    if (OSStatement(*_reader).executeScalar<int>("select count(*) from Person") != 200) {
+        throw OSException("Failed, 3");
+    }
+    
+    OSStatement(*_pool.writer()).execute("drop table Person");
+    
+    TEST_SUCCESS(OSDatabasePool);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSDatabasePool);
+}
+
+// Test: check OSDatabase::backupTo and restoreFrom while the source is written
+void test_OSDatabase_backup()
+try {
+    using namespace OSQLite;
+    const std::string _backupPath = databaseFilePath + ".backup";
+    std::remove(_backupPath.c_str());
+    // Both connections write while the backup reads.
+    OSDatabaseOptions _options;
+    _options.busyTimeout = 5000;
+    OSDatabase _database(databaseFilePath, _options);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    _statement.begin();
+    for (int _id = 1; _id <= 5000; ++_id) {
+        _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, std::string(40, 'n'), std::string(60, 'a'));
+    }
+    _statement.commit();
+    
+    // Small steps, with writes from this and another connection meanwhile.
+    int _steps = 0;
+    std::unique_ptr<OSBackup> _backup = _database.backupTo(_backupPath, 20, std::chrono::milliseconds(1), [&_steps](const OSBackupProgress&) {++_steps;});
+    {
+        OSDatabase _writer(databaseFilePath, _options);
+        OSStatement _writerStatement(_writer);
+        for (int _id = 5001; _id <= 5100; ++_id) {
+            (_id % 2 ? _statement : _writerStatement).execute("insert into Person(id, name, address) values(?, ?, ?)", _id, std::string("steven"), std::string("shanghai"));
+        }
+    }
+    if (!_backup->wait() || !_backup->finished() || _steps < 2 || _backup->progress().remaining != 0 || _backup->progress().fraction() != 1) {
+        throw OSException("Failed, 1");
+    }
+    int _count = 0;
+    {
+        OSDatabase _copy(_backupPath);
+        _count = OSStatement(_copy).executeScalar<int>("select count(*) from Person");
+        if (_count < 5000 || _count > 5100) {
+            throw OSException("Failed, 2");
+        }
+    }
+    
+    // Restore into memory, e.g. to warm a cache.
+    OSDatabase _memory(":memory:");
+    _memory.restoreFrom(_backupPath, -1)->wait();
+    if (OSStatement(_memory).executeScalar<int>("select count(*) from Person") != _count) {
+        throw OSException("Failed, 3");
+    }
+    
+    // A cancelled backup leaves the destination as it was.
+    _statement.execute("delete from Person where id > 100");
+    _backup = _database.backupTo(_backupPath, 1, std::chrono::milliseconds(50));
+    _backup->cancel();
+    if (_backup->wait()) {
+        throw OSException("Failed, 4");
+    }
+    _backup.reset();
+    {
+        OSDatabase _copy(_backupPath);
+        if (OSStatement(_copy).executeScalar<int>("select count(*) from Person") != _count) {
+            throw OSException("Failed, 5");
+        }
+    }
+    
+    bool _thrown = false;
+    try {
+        _memory.restoreFrom(databaseFilePath + ".missing")->wait();
+    } catch (const OSException& e) {
+        _thrown = e.tag() == SQLITE_CANTOPEN;
+    }
+    if (!_thrown) {
+        throw OSException("Failed, 6");
+    }
+    
+    _statement.execute("drop table Person");
+    std::remove(_backupPath.c_str());
+    
+    TEST_SUCCESS(OSDatabase_backup);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSDatabase_backup);
+    // Leave nothing behind for the tests after.
+    try {
+        OSQLite::OSDatabase _database(databaseFilePath);
+        OSQLite::OSStatement(_database).execute("drop table if exists Person");
+    } catch (const OSQLite::OSException&) {
+    }
+    std::remove((databaseFilePath + ".backup").c_str());
+}
+
+// Test: check the in-memory mirror mode of OSDatabase and its flushes
+void test_OSDatabase_mirror()
+try {
+    using namespace OSQLite;
+    // Another connection to the file, waiting while a flush writes it.
+    OSDatabaseOptions _diskOptions;
+    _diskOptions.busyTimeout = 5000;
+    auto _countOnDisk = [&_diskOptions]() {
+        OSDatabase _disk(databaseFilePath, _diskOptions);
+        return OSStatement(_disk).executeScalar<int>("select count(*) from Person");
+    };
+    {
+        OSDatabase _disk(databaseFilePath);
+        OSStatement _statement(_disk);
+        _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+        _statement.begin();
+        for (int _id = 1; _id <= 100; ++_id) {
+            _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, std::string("steven"), std::string("shanghai"));
+        }
+        _statement.commit();
+    }
+    
+    // Periodic flushes.
+    {
+        OSDatabase _database(databaseFilePath, OSDatabaseOptions::inMemoryMirror(std::chrono::milliseconds(20)));
+        OSStatement _statement(_database);
+        if (!_database.isMirror() || _statement.executeScalar<int>("select count(*) from Person") != 100) {
+            throw OSException("Failed, 1");
+        }
+        for (int _id = 101; _id <= 150; ++_id) {
+            _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, std::string("kevin"), std::string("beijing"));
+        }
+        int _count = 0;
+        for (int _i = 0; _i < 200 && (_count = _countOnDisk()) != 150; ++_i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (_count != 150) {
+            throw OSException("Failed, 2");
+        }
+    }
+    
+    // Explicit flushes only, and the last one when closed.
+    {
+        OSDatabase _database(databaseFilePath, OSDatabaseOptions::inMemoryMirror(std::chrono::milliseconds(0)));
+        OSStatement _statement(_database);
+        _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", 151, std::string("tom"), std::string("hangzhou"));
+        if (_countOnDisk() != 150) {
+            throw OSException("Failed, 3");
+        }
+        _database.flush();
+        if (_countOnDisk() != 151) {
+            throw OSException("Failed, 4");
+        }
+        _statement.execute("delete from Person where id > 100");
+    }
+    if (_countOnDisk() != 100) {
+        throw OSException("Failed, 5");
+    }
+    
+    OSDatabase _database(databaseFilePath);
+    OSStatement(_database).execute("drop table Person");
+    
+    TEST_SUCCESS(OSDatabase_mirror);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSDatabase_mirror);
+}
+
 // Test: check OSStatement::execute interfaces
 void test_OSStatement_execute()
 try {
@@ -94,6 +426,316 @@ try {
     std::cout << "ERROR: " << e.what() << std::endl;
     TEST_FAIL(executeRows);
 }
+
+// Test: OSStatement::executeCursor interface
+void test_OSStatement_executeCursor()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    _statement.execute("insert into Person(id, name, address) values(1, 'steven', 'shanghai'); insert into Person(id, name, address)  values(2, 'kevin', 'beijing')");
+    
+    int _count = 0;
+    for (auto& _row : _statement.executeCursor<int, std::string, std::string>("select * from Person order by id")) {
+        ++_count;
+        if (std::get<0>(_row) != _count) {
+            throw OSException("Failed, 1");
+        }
+    }
+    if (_count != 2) {
+        throw OSException("Failed, 2");
+    }
+    
+    // Breaking out early gives the statement back, the table can be dropped.
+    int _id = 1;
+    {
+        auto _cursor = _statement.executeCursor<std::string>("select name from Person where id>=? order by id", _id);
+        for (auto& _row : _cursor) {
+            if (std::get<0>(_row) != "steven") {
+                throw OSException("Failed, 3");
+            }
+            break;
+        }
+    }
+    auto _cursor = _statement.executeCursor<std::string>("select name from Person where id=2");
+    if (!_cursor.next() || std::get<0>(_cursor.row()) != "kevin" || _cursor.next()) {
+        throw OSException("Failed, 4");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(executeCursor);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(executeCursor);
+}
+
+// Test: zero-copy views and NULL handling in results
+void test_OSStatement_views()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    _statement.execute("insert into Person(id, name, address) values(1, 'steven', 'shanghai'); insert into Person(id, name, address)  values(2, 'kevin', null)");
+    
+    int _count = 0;
+    for (auto& _row : _statement.executeCursor<int, OSTextView, OSTextView>("select * from Person order by id")) {
+        const OSTextView& _address = std::get<2>(_row);
+        if (std::get<0>(_row) == 1 && (std::get<1>(_row) != "steven" || _address.isNull() || _address != "shanghai")) {
+            throw OSException("Failed, 1");
+        }
+        if (std::get<0>(_row) == 2 && (std::get<1>(_row).str() != "kevin" || !_address.isNull())) {
+            throw OSException("Failed, 2");
+        }
+        ++_count;
+    }
+    if (_count != 2) {
+        throw OSException("Failed, 3");
+    }
+    
+    // NULL text no longer crashes std::string, and OSNullable tells NULL apart.
+    auto resultVec = _statement.executeRows<std::string, OSNullable<std::string>>("select address, address from Person where id=2");
+    if (resultVec.size() != 1 || !std::get<0>(resultVec[0]).empty() || !std::get<1>(resultVec[0]).isNull()) {
+        throw OSException("Failed, 4");
+    }
+    OSNullable<std::string> _address("beijing");
+    int _id = 2;
+    _statement.execute("update Person set address=? where id=?", _address, _id);
+    if (_statement.executeScalar<OSNullable<std::string>>("select address from Person where id=2").value() != "beijing") {
+        throw OSException("Failed, 5");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(views);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(views);
+}
+
+// Test: blob bindings and results, and streaming with OSBlobReader/OSBlobWriter
+void test_OSStatement_blobs()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists File(id integer primary key, content blob)");
+    
+    std::vector<unsigned char> _bytes = {0, 1, 2, 0, 255, 'a'};
+    int _id = 1;
+    _statement.execute("insert into File(id, content) values(?, ?)", _id, _bytes);
+    if (_statement.executeScalar<std::vector<unsigned char>>("select content from File where id=?", _id) != _bytes) {
+        throw OSException("Failed, 1");
+    }
+    OSBlobView _view(_bytes.data() + 3, 3);
+    _id = 2;
+    _statement.execute("insert into File(id, content) values(?, ?)", _id, _view);
+    auto _rows = _statement.executeRows<int, std::vector<unsigned char>>("select id, content from File where id=?", _id);
+    if (_rows.size() != 1 || std::get<1>(_rows[0]) != std::vector<unsigned char>(_bytes.begin() + 3, _bytes.end())) {
+        throw OSException("Failed, 2");
+    }
+    
+    // 3 MB written and read back in 64 KB chunks.
+    const size_t _blobSize = 3 * 1024 * 1024, _chunkSize = 64 * 1024;
+    OSZeroBlob _zeroBlob(_blobSize);
+    _id = 3;
+    _statement.execute("insert into File(id, content) values(?, ?)", _id, _zeroBlob);
+    std::vector<unsigned char> _chunk(_chunkSize);
+    {
+        OSBlobWriter _writer(_database, "File", "content", _database.lastInsertRowid());
+        if (_writer.size() != _blobSize) {
+            throw OSException("Failed, 3");
+        }
+        for (size_t _offset = 0; _offset < _blobSize; _offset += _chunkSize) {
+            for (size_t _i = 0; _i < _chunkSize; ++_i)
+                _chunk[_i] = (unsigned char)((_offset + _i) % 251);
+            _writer.write(_chunk.data(), _chunkSize);
+        }
+        bool _thrown = false;
+        try {
+            _writer.write(_chunk.data(), 1);
+        } catch (const OSException& e) {
+            _thrown = e.tag() == SQLITE_RANGE;
+        }
+        if (!_thrown || _writer.remaining() != 0) {
+            throw OSException("Failed, 4");
+        }
+    }
+    {
+        OSBlobReader _reader(_database, "File", "content", 3);
+        size_t _total = 0;
+        while (size_t _read = _reader.read(_chunk.data(), _chunkSize)) {
+            for (size_t _i = 0; _i < _read; ++_i) {
+                if (_chunk[_i] != (unsigned char)((_total + _i) % 251)) {
+                    throw OSException("Failed, 5");
+                }
+            }
+            _total += _read;
+        }
+        if (_total != _blobSize) {
+            throw OSException("Failed, 6");
+        }
+        // Another row, and a read in the middle.
+        _reader.reopen(1);
+        _reader.seek(4);
+        if (_reader.size() != _bytes.size() || _reader.read(_chunk.data(), _chunkSize) != 2 || _chunk[0] != 255 || _chunk[1] != 'a') {
+            throw OSException("Failed, 7");
+        }
+    }
+    if (_statement.executeScalar<int>("select length(content) from File where id=3") != int(_blobSize)) {
+        throw OSException("Failed, 8");
+    }
+    
+    _statement.execute("drop table File");
+    
+    TEST_SUCCESS(blobs);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(blobs);
+}
+
+// Test: binding const values, temporaries, literals and views
+void test_OSStatement_bindings()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    
+    const int _id = 1;
+    const std::string _name = "steven";
+    _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, _name, "shanghai");
+    _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", 2, std::string("kev") + "in", nullptr);
+    std::string _buffer = "xxbeijingxx";
+    OSTextView _view;
+    _view.data = _buffer.data() + 2;
+    _view.size = 7;
+    _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", 3, "jack", _view);
+    
+    if (_statement.executeScalar<std::string>("select name from Person where id=?", 2) != "kevin"
+        || _statement.executeScalar<int>("select count(*) from Person where address is null") != 1
+        || _statement.executeScalar<std::string>("select address from Person where id=?", 1 + 2) != "beijing") {
+        throw OSException("Failed, 1");
+    }
+    auto _rows = _statement.executeRows<int>("select id from Person where name in (?, ?) order by id", std::string("jack"), _name);
+    if (_rows.size() != 2 || std::get<0>(_rows[0]) != 1 || std::get<0>(_rows[1]) != 3) {
+        throw OSException("Failed, 2");
+    }
+    // The cursor steps after the temporary is gone, so its text is copied.
+    auto _cursor = _statement.executeCursor<int>("select id from Person where name=?", std::string("steven"));
+    std::string _overwrite(64, 'z');
+    int _count = 0;
+    for (auto& _row : _cursor) {
+        _count += std::get<0>(_row);
+    }
+    if (_count != 1) {
+        throw OSException("Failed, 3");
+    }
+    // A cached statement keeps no pointer to the last arguments.
+    {
+        std::string _temporary = "steven";
+        _statement.executeScalar<int>("select count(*) from Person where name=?", _temporary);
+    }
+    if (_statement.executeScalar<int>("select count(*) from Person where name=?", "steven") != 1) {
+        throw OSException("Failed, 4");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(bindings);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(bindings);
+}
+
+// Test: OSStatement::executeMany with vectors and iterators of tuples
+void test_OSStatement_executeMany()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    const std::string _sqlString = "insert into Person(id, name, address) values(?, ?, ?)";
+    
+    std::vector<std::tuple<int, std::string, OSNullable<std::string>>> _rows;
+    for (int _id = 1; _id <= 1000; ++_id) {
+        _rows.push_back(std::make_tuple(_id, "name_" + std::to_string(_id), _id % 2 ? OSNullable<std::string>("shanghai") : OSNullable<std::string>()));
+    }
+    OSBatchTiming _timing = _statement.executeMany(_sqlString, _rows);
+    if (_timing.rows != 1000 || _statement.executeScalar<int>("select count(*) from Person where address is null") != 500
+        || _statement.executeScalar<std::string>("select name from Person where id=?", 999) != "name_999") {
+        throw OSException("Failed, 1");
+    }
+    
+    // A failing row rolls the whole batch back.
+    std::list<std::tuple<int, const char*, const char*>> _list = {std::make_tuple(1001, "kevin", "beijing"), std::make_tuple(1, "steven", "shanghai")};
+    bool _thrown = false;
+    try {
+        _statement.executeMany(_sqlString, _list.begin(), _list.end());
+    } catch (const OSException& e) {
+        _thrown = e.tag() == SQLITE_CONSTRAINT;
+    }
+    if (!_thrown || _statement.executeScalar<int>("select count(*) from Person") != 1000) {
+        throw OSException("Failed, 2");
+    }
+    
+    // Inside the caller's transaction, without a savepoint.
+    _list.pop_back();
+    _statement.begin();
+    _statement.executeMany(_sqlString, _list.begin(), _list.end(), false);
+    _statement.rollback();
+    if (_statement.executeScalar<int>("select count(*) from Person") != 1000) {
+        throw OSException("Failed, 3");
+    }
+    _statement.executeMany(_sqlString, _list.begin(), _list.end());
+    if (_statement.executeScalar<std::string>("select address from Person where id=1001") != "beijing") {
+        throw OSException("Failed, 4");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(executeMany);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(executeMany);
+}
+
+// Test: OSStatement::executeColumns interface and OSReduce
+void test_OSStatement_executeColumns()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Score(id integer not null, value real, primary key(id))");
+    _statement.begin();
+    for (int _id = 1; _id <= 1000; ++_id) {
+        double _value = _id * 0.5;
+        _statement.execute("insert into Score(id, value) values(?, ?)", _id, _value);
+    }
+    _statement.commit();
+    
+    auto _columns = _statement.executeColumns<int, double>("select id, value from Score order by id");
+    const OSColumn<int>& _ids = std::get<0>(_columns);
+    const OSColumn<double>& _values = std::get<1>(_columns);
+    if (_ids.size() != 1000 || _values.size() != 1000 || (size_t)_values.data() % OSQLITE_COLUMN_ALIGNMENT != 0) {
+        throw OSException("Failed, 1");
+    }
+    if (OSReduce::sum(_ids) != 500500 || OSReduce::sum(_values) != 250250.0) {
+        throw OSException("Failed, 2");
+    }
+    if (OSReduce::min(_ids) != 1 || OSReduce::max(_values) != 500.0 || OSReduce::countWhere(_values, [](double v) {return v > 250.0;}) != 500) {
+        throw OSException("Failed, 3");
+    }
+    
+    _statement.execute("drop table Score");
+    
+    TEST_SUCCESS(executeColumns);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(executeColumns);
+}
     
 // Test: OSStatement::executeScalar interface
 void test_OSStatement_executeScalar()
@@ -142,6 +784,242 @@ try {
     TEST_FAIL(transactions);
 }
 
+// Test: check the prepared statement cache used by OSStatement
+void test_OSStatement_statementCache()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    
+    OSStatementCache& _cache = _database.statementCache();
+    auto _misses = _cache.misses();
+    auto _hits = _cache.hits();
+    std::string _name = "steven";
+    std::string _address = "shanghai";
+    for (int _id = 1; _id <= 10; ++_id) {
+        _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, _name, _address);
+    }
+    if (_cache.misses()-_misses != 1 || _cache.hits()-_hits != 9) {
+        throw OSException("Failed, 1");
+    }
+    
+    // OSStatements of one OSDatabase on several threads share the cache.
+    _database.enableMetrics();
+    std::vector<std::thread> _threads;
+    std::atomic<bool> _failed(false);
+    for (int _thread = 0; _thread < 4; ++_thread) {
+        _threads.push_back(std::thread([&_database, &_failed, _thread]() {
+            try {
+                OSStatement _threadStatement(_database);
+                for (int _id = 1000 + _thread * 100; _id < 1100 + _thread * 100; ++_id) {
+                    _threadStatement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, "xiaoyu", "CUC");
+                    _threadStatement.executeScalar<int>("select count(*) from Person where id=?", _id);
+                }
+            } catch (const OSException&) {
+                _failed = true;
+            }
+        }));
+    }
+    for (auto& _thread : _threads) {
+        _thread.join();
+    }
+    _database.enableMetrics(false);
+    if (_failed || _statement.executeScalar<int>("select count(*) from Person where name='xiaoyu'") != 400) {
+        throw OSException("Failed, 4");
+    }
+    _statement.execute("delete from Person where name='xiaoyu'");
+    
+    // The same SQL while its cached statement is out runs on another one,
+    // which is finalized on release; the cached one comes back.
+    _statement.executeRows<int>("select id from Person order by id");
+    {
+        auto _cursor = _statement.executeCursor<int>("select id from Person order by id");
+        _misses = _cache.misses();
+        _hits = _cache.hits();
+        if (_statement.executeRows<int>("select id from Person order by id").size() != 10 || _cache.misses()-_misses != 1) {
+            throw OSException("Failed, 5");
+        }
+    }
+    _statement.executeRows<int>("select id from Person order by id");
+    if (_cache.hits()-_hits != 1) {
+        throw OSException("Failed, 6");
+    }
+    
+    // Capacity is enforced, least recently used statements are dropped.
+    _cache.setCapacity(1);
+    _statement.executeScalar<int>("select count(*) from Person");
+    if (_cache.size() != 1 || _statement.executeScalar<int>("select count(*) from Person") != 10) {
+        throw OSException("Failed, 2");
+    }
+    _cache.setCapacity(0);
+    if (_cache.size() != 0) {
+        throw OSException("Failed, 3");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(statementCache);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(statementCache);
+}
+
+// Test: check the statement metrics of OSDatabase
+void test_OSDatabase_metrics()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    
+    // Disabled by default, nothing is recorded.
+    _statement.executeScalar<int>("select count(*) from Person");
+    if (_database.metricsEnabled() || !_database.metrics().statements.empty()) {
+        throw OSException("Failed, 1");
+    }
+    
+    _database.enableMetrics();
+    std::string _name = "steven";
+    std::string _address = "shanghai";
+    for (int _id = 1; _id <= 100; ++_id) {
+        _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, _name, _address);
+    }
+    // Literals do not make a new fingerprint.
+    _statement.executeRows<int>("select id from Person where address = 'shanghai' order by name");
+    _statement.executeRows<int>("select id from Person where address =   'beijing' order by name");
+    
+    OSMetricsSnapshot _snapshot = _database.metrics();
+    if (_snapshot.statements.size() != 2 || _snapshot.total.executions != 102 || _snapshot.total.rows != 100) {
+        throw OSException("Failed, 2");
+    }
+    for (auto& _metrics : _snapshot.statements) {
+        if (_metrics.fingerprint == "insert into Person(id, name, address) values(?, ?, ?)") {
+            if (_metrics.executions != 100 || _metrics.prepares != 1 || _metrics.fullScanSteps != 0) {
+                throw OSException("Failed, 3");
+            }
+        } else if (_metrics.fingerprint == "select id from Person where address = ? order by name") {
+            if (_metrics.executions != 2 || _metrics.prepares != 2 || _metrics.fullScanSteps == 0 || _metrics.sorts != 2) {
+                throw OSException("Failed, 4");
+            }
+        } else {
+            throw OSException("Failed, 5");
+        }
+        if (_metrics.p50 > _metrics.p99 || _metrics.p99 > _metrics.p999 || _metrics.p999.count() == 0) {
+            throw OSException("Failed, 6");
+        }
+    }
+    if (_snapshot.pageCacheMemory <= 0 || _snapshot.statementMemory <= 0) {
+        throw OSException("Failed, 7");
+    }
+    
+    // SQL without parameters and transaction control are recorded too.
+    _statement.begin();
+    _statement.execute("update Person set address = 'beijing' where id > 50");
+    _statement.commit();
+    _snapshot = _database.metrics();
+    auto _executions = [&_snapshot](const std::string& fingerprint) {
+        for (auto& _metrics : _snapshot.statements) {
+            if (_metrics.fingerprint == fingerprint)
+                return _metrics.executions;
+        }
+        return 0ULL;
+    };
+    if (_snapshot.statements.size() != 5 || _executions("begin") != 1 || _executions("commit") != 1 || _executions("update Person set address = ? where id > ?") != 1) {
+        throw OSException("Failed, 8");
+    }
+    
+    // Enabling again starts from zero, also for the cached statements, and
+    // a batch is one execution.
+    _database.enableMetrics();
+    std::vector<std::tuple<int, std::string, std::string>> _rows = {std::make_tuple(101, _name, _address), std::make_tuple(102, _name, _address)};
+    _statement.executeMany("insert into Person(id, name, address) values(?, ?, ?)", _rows);
+    _snapshot = _database.metrics();
+    if (_snapshot.statements.size() != 1 || _executions("insert into Person(id, name, address) values(?, ?, ?)") != 1) {
+        throw OSException("Failed, 9");
+    }
+    
+    // The rank of a percentile is ceil(quantile*count): one slow sample of
+    // 100 is above p99, one of 1000 is above p999.
+    for (unsigned long long _count : {100ULL, 1000ULL}) {
+        OSLatencyHistogram _histogram;
+        for (unsigned long long _i = 1; _i < _count; ++_i) {
+            _histogram.record(std::chrono::microseconds(1));
+        }
+        _histogram.record(std::chrono::seconds(1));
+        if (_histogram.percentile(_count == 100 ? 0.99 : 0.999) >= std::chrono::milliseconds(1) || _histogram.percentile(1.0) < std::chrono::milliseconds(1)) {
+            throw OSException("Failed, 10");
+        }
+    }
+    
+    _database.enableMetrics(false);
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(metrics);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(metrics);
+}
+
+// Test: check the slow-query log of OSDatabase
+void test_OSDatabase_slowQueryLog()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    std::string _name = "steven";
+    std::string _address = "shanghai";
+    for (int _id = 1; _id <= 10; ++_id) {
+        _statement.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, _name, _address);
+    }
+    
+    // Threshold 0 logs every statement.
+    size_t _called = 0;
+    _database.enableSlowQueryLog(std::chrono::microseconds(0), 2, [&_called](const OSSlowQuery&) {++_called;});
+    int _id = 3;
+    _statement.executeScalar<std::string>("select name from Person where id=?", _id);
+    _statement.executeRows<int>("select id from Person where name=? order by address", _name);
+    
+    auto _entries = _database.slowQueries();
+    if (_called != 2 || _entries.size() != 2) {
+        throw OSException("Failed, 1");
+    }
+    if (_entries[0].expandedSQL != "select name from Person where id=3" || _entries[0].fullScan || _entries[0].queryPlan.empty()) {
+        throw OSException("Failed, 2");
+    }
+    if (_entries[1].expandedSQL != "select id from Person where name='steven' order by address" || !_entries[1].fullScan || !_entries[1].tempBTree) {
+        throw OSException("Failed, 3");
+    }
+    
+    // Only the newest capacity entries are kept, fast ones are not logged.
+    _statement.executeScalar<int>("select count(*) from Person");
+    if (_database.slowQueries().size() != 2 || _database.slowQueries()[1].sqlString != "select count(*) from Person") {
+        throw OSException("Failed, 4");
+    }
+    _database.enableSlowQueryLog(std::chrono::microseconds(1000000));
+    _statement.executeScalar<int>("select count(*) from Person");
+    if (!_database.slowQueries().empty()) {
+        throw OSException("Failed, 5");
+    }
+    
+    // Statements without parameters are logged too.
+    _database.enableSlowQueryLog(std::chrono::microseconds(0));
+    _statement.execute("delete from Person where id > 5");
+    _entries = _database.slowQueries();
+    if (_entries.size() != 1 || _entries[0].expandedSQL != "delete from Person where id > 5" || _statement.executeScalar<int>("select count(*) from Person") != 5) {
+        throw OSException("Failed, 6");
+    }
+    
+    _database.disableSlowQueryLog();
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(slowQueryLog);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(slowQueryLog);
+}
+
 
 // Sample class displaying how to use OSQuery and OSTablePolicy.
 // You just need to inherit OSTablePolicy class, and bind table name, primary
@@ -160,6 +1038,44 @@ public:
     std::string _address;
 };
 
+// Test: OSTablePolicy registers a table once, also from concurrent threads,
+// and objects carry no binding data.
+void test_OSTablePolicy_registration()
+try {
+    using namespace OSQLite;
+    std::vector<std::thread> _threads;
+    bool _failed[4] = {false, false, false, false};
+    for (int _t = 0; _t < 4; ++_t) {
+        _threads.push_back(std::thread([&_failed, _t]() {
+            try {
+                for (int _i = 0; _i < 1000; ++_i) {
+                    int _id = _i;
+                    Person _personObject(_id, "xiaoyu", "CUC");
+                    _failed[_t] = _failed[_t] || !_personObject.checkBindings();
+                }
+            } catch (const OSException&) {
+                _failed[_t] = true;
+            }
+        }));
+    }
+    for (auto& _thread : _threads) {
+        _thread.join();
+    }
+    if (_failed[0] || _failed[1] || _failed[2] || _failed[3]) {
+        throw OSException("Failed, 1");
+    }
+    
+    // Only the vtable pointers are added to the mapped members.
+    if (sizeof(Person) > sizeof(int) + 2*sizeof(std::string) + 3*sizeof(void*)) {
+        throw OSException("Failed, 2");
+    }
+    
+    TEST_SUCCESS(registration);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(registration);
+}
+
 // Test: check OSQuery::save interface
 void test_OSQuery_save()
 try {
@@ -297,7 +1213,9 @@ try {
     std::string _name = "xiaoyu";
     std::string _address = "CUC";
     Person _personObject(_id, _name, _address);
-    _query.saveOrUpdate(_personObject);
+    if (_query.saveOrUpdate(_personObject)) {
+        throw OSException("Failed, updated");
+    }
     
     auto resultVec = _statement.executeRows<int, std::string, std::string>("select * from Person");
     
@@ -312,7 +1230,9 @@ try {
     
     _id = 2;
     Person _personObject2(_id, _name, _address);
-    _query.saveOrUpdate(_personObject2);
+    if (!_query.saveOrUpdate(_personObject2)) {
+        throw OSException("Failed, saved");
+    }
     auto resultVec2 = _statement.executeRows<int, std::string, std::string>("select * from Person where id='2'");
     
     if (resultVec2.size()!=1) {
@@ -348,6 +1268,10 @@ try {
     Person _personObject(_id, _name, _address);
     _query.deleteObject(_personObject);
     
+    if (_statement.executeScalar<int>("select count(*) from Person") != 0) {
+        throw OSException("Failed");
+    }
+    
     _statement.execute("drop table Person");
         
     TEST_SUCCESS(deleteObject);
@@ -356,27 +1280,505 @@ try {
     TEST_FAIL(deleteObject);
 }
 
+// Test: OSQuery reuses one prepared statement per table type and operation
+void test_OSQuery_statementReuse()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    
+    OSQuery _query(_database);
+    OSStatementCache& _cache = _database.statementCache();
+    auto _misses = _cache.misses();
+    std::string _name = "xiaoyu";
+    std::string _address = "CUC";
+    for (int _i = 1; _i <= 5; ++_i) {
+        int _id = _i;
+        Person _personObject(_id, _name, _address);
+        _query.save(_personObject);
+    }
+    if (_cache.misses()-_misses != 1 || _statement.executeScalar<int>("select count(*) from Person") != 5) {
+        throw OSException("Failed, 1");
+    }
+    
+    // Primary keys are bound, so every key shares the same statement.
+    _misses = _cache.misses();
+    for (int _i = 1; _i <= 6; ++_i) {
+        int _id = _i;
+        Person _personObject(_id, _name, _address);
+        if (_query.exists(_personObject) != (_i <= 5)) {
+            throw OSException("Failed, 2");
+        }
+    }
+    if (_cache.misses()-_misses != 1) {
+        throw OSException("Failed, 3");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(statementReuse);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(statementReuse);
+}
+
+// Test: check OSQuery::saveAll, updateAll and deleteAll interfaces
+void test_OSQuery_bulk()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    
+    OSQuery _query(_database);
+    std::list<Person> _persons;
+    std::string _name = "xiaoyu";
+    std::string _address = "CUC";
+    for (int _id = 1; _id <= 1000; ++_id) {
+        _persons.emplace_back(_id, _name, _address);
+    }
+    auto _timings = _query.saveAll(_persons, 300);
+    if (_timings.size() != 4 || _timings[3].rows != 100 || _statement.executeScalar<int>("select count(*) from Person") != 1000) {
+        throw OSException("Failed, 1");
+    }
+    
+    std::vector<Person*> _pointers;
+    for (auto& _person : _persons) {
+        _person._name = "steven";
+        _pointers.push_back(&_person);
+    }
+    _timings = _query.updateAll(_pointers);
+    if (_timings.size() != 1 || _statement.executeScalar<int>("select count(*) from Person where name='steven'") != 1000) {
+        throw OSException("Failed, 2");
+    }
+    
+    _query.deleteAll(_persons, 256);
+    if (_statement.executeScalar<int>("select count(*) from Person") != 0) {
+        throw OSException("Failed, 3");
+    }
+    
+    // A failed batch is rolled back.
+    _query.save(_persons.back());
+    try {
+        _query.saveAll(_persons);
+        throw OSException("Failed, 4");
+    } catch (const OSException& e) {
+        if (std::string(e.what()) == "Failed, 4") {
+            throw;
+        }
+    }
+    if (_statement.executeScalar<int>("select count(*) from Person") != 1) {
+        throw OSException("Failed, 5");
+    }
+    
+    _statement.execute("drop table Person");
+    
+    TEST_SUCCESS(bulk);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(bulk);
+}
+
+// Test: the object cache answers repeated fill and exists, and drops rows
+// changed through the connection
+void test_OSQuery_objectCache()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    _statement.execute("insert into Person(id, name, address) values(1, 'steven', 'shanghai'), (2, 'xiaoyu', 'CUC')");
+    _database.enableObjectCache();
+    
+    OSQuery _query(_database);
+    int _id = 1;
+    std::string _name, _address;
+    Person _person(_id, _name, _address);
+    _query.fill(_person);
+    _person._name = "";
+    _query.fill(_person);
+    if (_person._name != "steven" || _database.objectCacheStatistics().hits != 1 || _database.objectCacheStatistics().entries != 1) {
+        throw OSException("Failed, 1");
+    }
+    if (!_query.exists(_person) || _database.objectCacheStatistics().hits != 2) {
+        throw OSException("Failed, 2");
+    }
+    
+    // An OSQuery write drops its own row only.
+    _person._id = 2;
+    _query.fill(_person);
+    _person._address = "Beijing";
+    _query.update(_person);
+    _person._address = "";
+    _query.fill(_person);
+    _person._id = 1;
+    _query.fill(_person);
+    if (_person._name != "steven" || _database.objectCacheStatistics().hits != 3) {
+        throw OSException("Failed, 3");
+    }
+    _person._id = 2;
+    _query.fill(_person);
+    if (_person._address != "Beijing") {
+        throw OSException("Failed, 4");
+    }
+    
+    // Any other write drops the rows of the table.
+    _statement.execute("update Person set name='stevie' where id=1");
+    _person._id = 1;
+    _query.fill(_person);
+    if (_person._name != "stevie") {
+        throw OSException("Failed, 5");
+    }
+    _statement.execute("delete from Person");
+    if (_query.fill(_person) || _query.exists(_person)) {
+        throw OSException("Failed, 6");
+    }
+    
+    // Rows read in a transaction are not cached.
+    _statement.execute("insert into Person(id, name, address) values(1, 'steven', 'shanghai')");
+    _statement.execute("begin");
+    _query.fill(_person);
+    _statement.execute("commit");
+    if (_database.objectCacheStatistics().entries != 0) {
+        throw OSException("Failed, 7");
+    }
+    
+    // The least recently used rows go beyond the memory budget.
+    _query.fill(_person);
+    size_t _bytes = _database.objectCacheStatistics().bytes;
+    _statement.execute("insert into Person(id, name, address) values(2, 'xiaoyu', 'CUC')");
+    _database.enableObjectCache(_bytes + _bytes / 2);
+    _query.fill(_person);
+    _person._id = 2;
+    _query.fill(_person);
+    OSObjectCacheStatistics _statistics = _database.objectCacheStatistics();
+    if (_statistics.entries != 1 || _statistics.evictions != 1 || _statistics.bytes > _statistics.memoryBudget || _statistics.hitRate() <= 0 || _statistics.hitRate() >= 1) {
+        throw OSException("Failed, 8");
+    }
+    
+    _database.disableObjectCache();
+    _query.fill(_person);
+    if (_database.objectCacheStatistics().hits != 0) {
+        throw OSException("Failed, 9");
+    }
+    
+    // Dropping works while the cache is enabled, and empties it.
+    _database.enableObjectCache();
+    _query.fill(_person);
+    _statement.execute("create view PersonView as select * from Person");
+    _statement.execute("drop view PersonView");
+    _statement.execute("drop table Person");
+    if (_statement.executeScalar<int>("select count(*) from sqlite_master where name in ('Person', 'PersonView')") != 0 || _database.objectCacheStatistics().entries != 0) {
+        throw OSException("Failed, 10");
+    }
+    _database.disableObjectCache();
+    
+    TEST_SUCCESS(objectCache);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(objectCache);
+}
+
+// Test: check OSAsyncDatabase runs SQL and OSQuery work in submission order
+void test_OSAsyncDatabase()
+try {
+    using namespace OSQLite;
+    OSAsyncDatabase _database(databaseFilePath, OSDatabaseOptions(), 8);
+    _database.execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    
+    // More submissions than the queue holds: submit waits for room.
+    std::vector<std::future<void>> _inserts;
+    for (int _id = 1; _id <= 100; ++_id) {
+        _inserts.push_back(_database.execute("insert into Person(id, name, address) values(?, ?, ?)", _id, std::string("steven"), std::string("shanghai")));
+    }
+    std::future<int> _count = _database.executeScalar<int>("select count(*) from Person");
+    if (_count.get() != 100 || _database.pending() > _database.queueCapacity()) {
+        throw OSException("Failed, 1");
+    }
+    for (auto& _insert : _inserts) {
+        _insert.get();
+    }
+    
+    auto _rows = _database.executeRows<int, std::string>("select id, name from Person where id<=?", 10).get();
+    if (_rows.size() != 10 || std::get<1>(_rows[9]) != "steven") {
+        throw OSException("Failed, 2");
+    }
+    
+    // Errors come back through the future, and to callbacks.
+    try {
+        _database.execute("insert into Person(id) values(?)", 1).get();
+        throw OSException("Failed, 3");
+    } catch (const OSException& e) {
+        if (std::string(e.what()) == "Failed, 3") {
+            throw;
+        }
+    }
+    std::promise<bool> _callbackFailed;
+    _database.submit([](OSDatabase& database_) {
+        OSStatement(database_).execute("insert into Person(id) values(1)");
+    }, [&_callbackFailed](std::future<void> result_) {
+        try {
+            result_.get();
+            _callbackFailed.set_value(false);
+        } catch (const OSException&) {
+            _callbackFailed.set_value(true);
+        }
+    });
+    if (!_callbackFailed.get_future().get()) {
+        throw OSException("Failed, 4");
+    }
+    
+    int _id = 101;
+    Person _person(_id, "xiaoyu", "CUC");
+    auto _saved = _database.save(_person);
+    auto _exists = _database.exists(_person);
+    // The object is in use until the futures are ready.
+    _saved.get();
+    _person._name = "nobody";
+    if (!_exists.get() || !_database.fill(_person).get() || _person._name != "xiaoyu") {
+        throw OSException("Failed, 5");
+    }
+    _database.deleteObject(_person).get();
+    
+    _database.execute("drop table Person").get();
+    
+    TEST_SUCCESS(OSAsyncDatabase);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSAsyncDatabase);
+}
+
+// Test: check OSGroupCommitQueue batches the writes of many threads
+void test_OSGroupCommitQueue()
+try {
+    using namespace OSQLite;
+    {
+        OSDatabase _database(databaseFilePath);
+        OSStatement(_database).execute("create table if not exists Person(id integer not null, name varchar(56), address text, primary key(id))");
+    }
+    OSGroupCommitQueue _queue(databaseFilePath, 64, std::chrono::milliseconds(5));
+    
+    std::atomic<int> _failures(0);
+    std::vector<std::thread> _threads;
+    for (int _t = 0; _t < 8; ++_t) {
+        _threads.emplace_back([&_queue, &_failures, _t]() {
+            std::vector<std::future<void>> _writes;
+            for (int _i = 0; _i < 100; ++_i) {
+                _writes.push_back(_queue.execute("insert into Person(id, name, address) values(?, ?, ?)", _t*100+_i+1, std::string("steven"), std::string("shanghai")));
+            }
+            for (auto& _write : _writes) {
+                try {
+                    _write.get();
+                } catch (const OSException&) {
+                    ++_failures;
+                }
+            }
+        });
+    }
+    for (auto& _thread : _threads) {
+        _thread.join();
+    }
+    if (_failures != 0 || _queue.operations() != 800 || _queue.batches() >= 800) {
+        throw OSException("Failed, 1");
+    }
+    
+    // A failed write does not undo the rest of its batch.
+    auto _duplicate = _queue.execute("insert into Person(id) values(?)", 1);
+    auto _next = _queue.execute("insert into Person(id) values(?)", 801);
+    _next.get();
+    try {
+        _duplicate.get();
+        throw OSException("Failed, 2");
+    } catch (const OSException& e) {
+        if (std::string(e.what()) == "Failed, 2") {
+            throw;
+        }
+    }
+    
+    // One that rolls the whole transaction back fails the writes before it
+    // in the batch, and the writes after it run in a new transaction.
+    auto _rolledBack = _queue.execute("insert into Person(id) values(?)", 802);
+    auto _rollback = _queue.execute("insert or rollback into Person(id) values(?)", 1);
+    auto _after = _queue.execute("insert into Person(id) values(?)", 803);
+    _after.get();
+    for (auto _failed : {&_rolledBack, &_rollback}) {
+        try {
+            _failed->get();
+            throw OSException("Failed, 4");
+        } catch (const OSException& e) {
+            if (std::string(e.what()) == "Failed, 4") {
+                throw;
+            }
+        }
+    }
+    
+    int _count = 0;
+    _queue.submit([&_count](OSDatabase& database_) {
+        _count = OSStatement(database_).executeScalar<int>("select count(*) from Person");
+    }).get();
+    if (_count != 802) {
+        throw OSException("Failed, 3");
+    }
+    _queue.execute("drop table Person").get();
+    
+    TEST_SUCCESS(OSGroupCommitQueue);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSGroupCommitQueue);
+}
+
+// Test: check OSBulkLoader with delimited and fixed-width files
+void test_OSBulkLoader()
+try {
+    using namespace OSQLite;
+    OSDatabase _database(databaseFilePath);
+    OSStatement _statement(_database);
+    const std::string _filePath = databaseFilePath + ".csv";
+    {
+        std::ofstream _file(_filePath, std::ios::binary);
+        _file << "id,name,address,score\n";
+        for (int _id = 1; _id <= 10000; ++_id) {
+            if (_id % 1000 == 1)
+                _file << _id << ",\"steven, \"\"the\"\" chang\",shanghai,\r\n";
+            else
+                _file << _id << ",name_" << _id << ",\"address\"," << _id * 0.5 << "\n";
+        }
+    }
+    OSBulkLoadOptions _options;
+    _options.header = true;
+    _options.batchSize = 512;
+    _options.transactionSize = 4000;
+    size_t _progress = 0;
+    _options.progress = [&_progress](const OSBulkLoadStatistics&) {++_progress;};
+    const std::vector<std::string> _columns = {"id", "name", "address", "score"};
+    const std::vector<OSFieldType> _types = {OSFieldType::integer, OSFieldType::text, OSFieldType::text, OSFieldType::real};
+    
+    for (size_t _threads : {1, 4}) {
+        _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, score real, primary key(id))");
+        _options.parserThreads = _threads;
+        _progress = 0;
+        OSBulkLoadStatistics _statistics = OSBulkLoader(_database, "Person", _columns, _types, _options).load(_filePath);
+        if (_statistics.rows != 10000 || _statistics.transactions != 3 || _progress != 3
+            || _statement.executeScalar<int>("select count(*) from Person") != 10000
+            || _statement.executeScalar<int>("select count(*) from Person where score is null") != 10
+            || _statement.executeScalar<std::string>("select name from Person where id=1001") != "steven, \"the\" chang"
+            || _statement.executeScalar<std::string>("select address from Person where id=9999") != "address"
+            || _statement.executeScalar<double>("select score from Person where id=9999") != 4999.5) {
+            throw OSException("Failed, 1");
+        }
+        _statement.execute("drop table Person");
+    }
+    
+    // A bad record: its transaction is rolled back, the pragmas restored.
+    {
+        std::ofstream _file(_filePath, std::ios::binary);
+        _file << "1,steven,shanghai,1.5\n2,kevin,beijing,abc\n";
+    }
+    _statement.execute("create table if not exists Person(id integer not null, name varchar(56), address text, score real, primary key(id))");
+    const std::string _journalMode = _statement.executeScalar<std::string>("pragma journal_mode");
+    _options.header = false;
+    _options.parserThreads = 1;
+    bool _thrown = false;
+    try {
+        OSBulkLoader(_database, "Person", _columns, _types, _options).load(_filePath);
+    } catch (const OSException& e) {
+        _thrown = e.tag() == SQLITE_MISMATCH;
+    }
+    if (!_thrown || _statement.executeScalar<int>("select count(*) from Person") != 0
+        || _statement.executeScalar<std::string>("pragma journal_mode") != _journalMode) {
+        throw OSException("Failed, 2");
+    }
+    
+    // A quoted field of many lines, which look like records, is not split
+    // between the parsers.
+    {
+        std::ofstream _file(_filePath, std::ios::binary);
+        _file << "1,steven,shanghai,1.5\n2,\"kevin";
+        for (int _line = 0; _line < 20; ++_line)
+            _file << "\n" << _line + 10 << ",x,y,0";
+        _file << "\",beijing,2.5\n3,tom,CUC,3.5\n4,jerry,CUC,4.5\n";
+    }
+    for (size_t _threads : {1, 2, 4}) {
+        _options.parserThreads = _threads;
+        OSBulkLoader(_database, "Person", _columns, _types, _options).load(_filePath);
+        if (_statement.executeScalar<int>("select count(*) from Person") != 4
+            || _statement.executeScalar<int>("select length(name) - length(replace(name, char(10), '')) from Person where id=2") != 20
+            || _statement.executeScalar<std::string>("select address from Person where id=2") != "beijing") {
+            throw OSException("Failed, 4");
+        }
+        _statement.execute("delete from Person");
+    }
+    _options.parserThreads = 1;
+    
+    // Fixed-width records, one short.
+    {
+        std::ofstream _file(_filePath, std::ios::binary);
+        _file << "   1steven    shanghai  \r\n  22kevin     beijing   \n 333tom\n";
+    }
+    _options.fieldWidths = {4, 10, 10, 4};
+    OSBulkLoader(_database, "Person", _columns, _types, _options).load(_filePath);
+    if (_statement.executeScalar<int>("select count(*) from Person") != 3
+        || _statement.executeScalar<std::string>("select address from Person where id=22") != "beijing"
+        || _statement.executeScalar<std::string>("select address from Person where id=333") != "") {
+        throw OSException("Failed, 3");
+    }
+    
+    _statement.execute("drop table Person");
+    std::remove(_filePath.c_str());
+    
+    TEST_SUCCESS(OSBulkLoader);
+} catch (const OSQLite::OSException& e) {
+    std::cout << "ERROR: " << e.what() << std::endl;
+    TEST_FAIL(OSBulkLoader);
+}
+
 int main(int argc, const char * argv[]) {
 
 	// On my Macbook:
 	// Performance: 1000 test suite loops, 11000 open&close ops, 50000 sql access->21.775s
 
 	std::cout << "Test... OSDatabase" << std::endl;
+	test_OSMemoryPool();
 	test_OSDatabase_ctors_dtors();
+	test_OSDatabase_options();
+	test_OSDatabasePool();
+	test_OSDatabase_backup();
+	test_OSDatabase_mirror();
 
 	std::cout << "Test... OSStatement" << std::endl;
 	test_OSStatement_execute();
 	test_OSStatement_executeRows();
+	test_OSStatement_executeCursor();
+	test_OSStatement_views();
+	test_OSStatement_blobs();
+	test_OSStatement_bindings();
+	test_OSStatement_executeMany();
+	test_OSStatement_executeColumns();
 	test_OSStatement_executeScalar();
 	test_OSStatement_transactions();
+	test_OSStatement_statementCache();
+	test_OSDatabase_metrics();
+	test_OSDatabase_slowQueryLog();
 
 	std::cout << "Test... OSQuery and OSTablePolicy tests" << std::endl;
+	test_OSTablePolicy_registration();
 	test_OSQuery_save();
 	test_OSQuery_exists();
 	test_OSQuery_fill();
 	test_OSQuery_update();
 	test_OSQuery_saveOrUpdate();
 	test_OSQuery_deleteObject();
+	test_OSQuery_statementReuse();
+	test_OSQuery_bulk();
+	test_OSQuery_objectCache();
+
+	std::cout << "Test... OSAsyncDatabase and OSGroupCommitQueue" << std::endl;
+	test_OSAsyncDatabase();
+	test_OSGroupCommitQueue();
+
+	std::cout << "Test... OSBulkLoader" << std::endl;
+	test_OSBulkLoader();
 
     return 0;
 }